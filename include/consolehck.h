@@ -3,6 +3,8 @@
 
 #include "glhck/glhck.h"
 
+#include <stdarg.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -16,67 +18,480 @@ typedef enum consolehckContinue {
 // Console input callback signature
 typedef consolehckContinue (* consolehckInputCallback)(struct consolehckConsole*, unsigned int const*);
 
+// Span of one token in a tokenized input line, in codepoints
+typedef struct consolehckToken {
+  unsigned int start;
+  unsigned int length;
+} consolehckToken;
+
+// Command callback signature, gets the input line and its tokens with argv[0] being the command name
+typedef consolehckContinue (* consolehckCommandCallback)(struct consolehckConsole*, unsigned int const*, unsigned int const argc, consolehckToken const* argv);
+
 typedef enum consolehckWrapMode {
   CONSOLEHCK_NO_WRAP, CONSOLEHCK_WRAP
 } consolehckWrapMode;
 
+// Immediate consoles render on Update/Refresh, deferred ones only mark state dirty
+// and render at most once per consolehckConsoleTick or on consolehckConsoleFlush
+typedef enum consolehckUpdateMode {
+  CONSOLEHCK_UPDATE_IMMEDIATE, CONSOLEHCK_UPDATE_DEFERRED
+} consolehckUpdateMode;
+
+// Whether glyphs of a font are laid out in fixed-width cells. DETECT probes the advances of every font and size once.
+typedef enum consolehckFontSpacing {
+  CONSOLEHCK_SPACING_DETECT, CONSOLEHCK_SPACING_PROPORTIONAL, CONSOLEHCK_SPACING_MONOSPACE
+} consolehckFontSpacing;
+
+// Parts of the console that changed since the last render
+typedef enum consolehckDirtyFlags {
+  CONSOLEHCK_DIRTY_OUTPUT = 1,
+  CONSOLEHCK_DIRTY_INPUT = 2,
+  CONSOLEHCK_DIRTY_PROMPT = 4,
+  CONSOLEHCK_DIRTY_OFFSET = 8,
+  CONSOLEHCK_DIRTY_ALL = 15
+} consolehckDirtyFlags;
+
+// Phases of a frame the stats time. MEASURE and ENCODE time spent laying out counts in LAYOUT too.
+typedef enum consolehckPhase {
+  CONSOLEHCK_PHASE_DRAIN, // Queued output moved into the scrollback
+  CONSOLEHCK_PHASE_SETUP, // Framebuffer, projection, clearing and background planes
+  CONSOLEHCK_PHASE_ENCODE, // UTF-8 encoding of the prompt and the visible input
+  CONSOLEHCK_PHASE_LAYOUT, // Wrapping and placing output and input
+  CONSOLEHCK_PHASE_MEASURE, // Font metrics calls for glyphs missing from the glyph cache
+  CONSOLEHCK_PHASE_STASH, // glhckTextStash
+  CONSOLEHCK_PHASE_RENDER, // glhckTextRender and glhckTextClear
+  CONSOLEHCK_PHASE_COUNT
+} consolehckPhase;
+
+// Timers in nanoseconds and counters summed since the stats were enabled or last reset
+typedef struct consolehckStats {
+  unsigned long long time[CONSOLEHCK_PHASE_COUNT];
+  unsigned long long frames;
+  unsigned long long frameTime;
+  unsigned long long maxFrameTime;
+  unsigned long long linesLaidOut; // Lines whose wrap points were computed
+  unsigned long long rowsLaidOut; // Rows placed in a layout
+  unsigned long long measureCalls;
+  unsigned long long glyphsStashed;
+  unsigned long long bytesAllocated; // Heap memory requested while draining, laying out and drawing
+  unsigned long long allocations;
+} consolehckStats;
+
+// Bytes holding data and bytes allocated in total, reserved includes used
+typedef struct consolehckMemory {
+  size_t used;
+  size_t reserved;
+} consolehckMemory;
+
+// Memory of a console by component. The glyph atlas and the console texture are estimated from their dimensions.
+typedef struct consolehckMemoryUsage {
+  consolehckMemory output; // Scrollback text, lines, spans and the find query
+  consolehckMemory input; // Input line, prompt, draft, search query, tokens and completions
+  consolehckMemory callbacks; // Input callbacks and the command registry
+  consolehckMemory history;
+  consolehckMemory indexes; // Trigram indexes of the history and of the output once it has been searched
+  consolehckMemory layout; // Glyph cache and layout buffers
+  consolehckMemory glyphAtlas;
+  consolehckMemory texture;
+  consolehckMemory total;
+} consolehckMemoryUsage;
+
 typedef struct consolehckStringBuffer {
   unsigned int* data;
   unsigned int length;
   unsigned int bufferSize;
 } consolehckStringBuffer;
 
-typedef struct consolehckTextArea {
+#define CONSOLEHCK_TRIGRAM_BUCKET_BITS 14
+#define CONSOLEHCK_TRIGRAM_BUCKETS (1 << CONSOLEHCK_TRIGRAM_BUCKET_BITS)
+
+// Sorted postings of ids for every hashed byte trigram, used to narrow substring searches down to candidates.
+typedef struct consolehckTrigramIndex {
+  unsigned int** postings;
+  unsigned int* lengths;
+  unsigned int* sizes;
+} consolehckTrigramIndex;
+
+// Style attributes, FOREGROUND and BACKGROUND mark the respective color as set
+typedef enum consolehckAttribute {
+  CONSOLEHCK_ATTRIBUTE_FOREGROUND = 1,
+  CONSOLEHCK_ATTRIBUTE_BACKGROUND = 2,
+  CONSOLEHCK_ATTRIBUTE_BOLD = 4,
+  CONSOLEHCK_ATTRIBUTE_DIM = 8,
+  CONSOLEHCK_ATTRIBUTE_ITALIC = 16,
+  CONSOLEHCK_ATTRIBUTE_UNDERLINE = 32,
+  CONSOLEHCK_ATTRIBUTE_INVERSE = 64
+} consolehckAttribute;
+
+// Colors and consolehckAttribute flags of a run of text, all zero is the default style
+typedef struct consolehckStyle {
+  glhckColorb foreground;
+  glhckColorb background;
+  unsigned int attributes;
+} consolehckStyle;
+
+// Run of text in one style, lasting from byte id start up to the start of the next span
+typedef struct consolehckSpan {
+  unsigned int start;
+  consolehckStyle style;
+} consolehckSpan;
+
+#define CONSOLEHCK_ESCAPE_MAX 32
+
+// Line in the scrollback: ring position of its first byte and its length in bytes without the newline.
+// The number of wrap-lines computed for layout generation layoutKey is cached along with it, and so are their
+// starts (byte offsets into the line) once the line has been on screen. rowStarts is NULL until then and for single rows.
+// rowsAbove is a running count of the wrapped rows of the lines before it, see consolehckScrollback.
+typedef struct consolehckLine {
+  unsigned int start;
+  unsigned int length;
+  unsigned int layoutKey;
+  unsigned int numRows;
+  unsigned int* rowStarts;
+  unsigned int rowsAbove;
+} consolehckLine;
+
+// Ring buffer of UTF-8 encoded output with a ring of line records indexing it.
+// Sizes and positions are in bytes, trimming old text only ever cuts at character boundaries.
+// numLines counts complete lines, the open last line is always lines[numLines].
+// The oldest lines are dropped once maxLines complete lines or maxSize bytes of
+// text are exceeded (0 = unlimited).
+// Styled text is described by spans[firstSpan..firstSpan + numSpans), keyed by byte id where the byte at index i
+// has id startId + i. Text before the first span and all text while there are none has the default style.
+// New text gets style, ANSI SGR escapes in pushed text change it, escape holds one still incomplete.
+// Once search is enabled, complete lines are posted to searchIndex by block of CONSOLEHCK_SEARCH_BLOCK_LINES
+// line ids, where line i has id firstLineId + i. Blocks of dropped lines are pruned in bulk.
+// Lines with ids in [rowsFirstId, rowsEndId) hold rowsAbove counted for layout generation rowsKey from an arbitrary
+// base, only differences between them are meaningful.
+typedef struct consolehckScrollback {
+  char* data;
+  unsigned int bufferSize;
+  unsigned int start;
+  unsigned int length;
+  consolehckLine* lines;
+  unsigned int linesSize;
+  unsigned int firstLine;
+  unsigned int numLines;
+  unsigned int maxLines;
+  unsigned int maxSize;
+  unsigned int layoutKey;
+  float layoutWidth;
+  unsigned int layoutFontId;
+  unsigned int layoutFontSize;
+  unsigned int rowsKey;
+  unsigned int rowsFirstId;
+  unsigned int rowsEndId;
+  unsigned int firstLineId;
+  consolehckTrigramIndex* searchIndex;
+  unsigned int searchFirstBlock;
+  char* lineScratch;
+  unsigned int lineScratchSize;
+  unsigned int startId;
+  consolehckSpan* spans;
+  unsigned int spansSize;
+  unsigned int firstSpan;
+  unsigned int numSpans;
+  consolehckStyle style;
+  char escape[CONSOLEHCK_ESCAPE_MAX];
+  unsigned int escapeLength;
+} consolehckScrollback;
+
+#define CONSOLEHCK_SEARCH_BLOCK_LINES 256
+
+// Match of a search in the scrollback: line number (0 = oldest kept line), byte offset and length within it
+typedef struct consolehckMatch {
+  unsigned int line;
+  unsigned int start;
+  unsigned int length;
+} consolehckMatch;
+
+// Colors text is rendered in: foreground and background stand in for colors spans leave unset,
+// occurrences of highlight (NULL for none) are drawn in highlightColor
+typedef struct consolehckTextColors {
+  glhckColorb foreground;
+  glhckColorb background;
+  char const* highlight;
+  unsigned int highlightLength;
+  glhckColorb highlightColor;
+} consolehckTextColors;
+
+// Editable codepoints with a gap at the cursor, data[gapStart..gapEnd) is unused.
+// Inserting and deleting at the cursor is O(1), moving the cursor shifts only the codepoints it passes.
+typedef struct consolehckGapBuffer {
+  unsigned int* data;
+  unsigned int bufferSize;
+  unsigned int gapStart;
+  unsigned int gapEnd;
+} consolehckGapBuffer;
+
+// Submitted input lines as UTF-8 in one arena, indexed by offsets and by trigrams for search.
+// Entry i (0 = oldest kept) is data[offsets[first + i]..offsets[first + i + 1]).
+// The oldest entries are dropped beyond maxEntries (0 = unlimited).
+typedef struct consolehckHistory {
+  char* data;
+  unsigned int dataSize;
+  unsigned int* offsets;
+  unsigned int offsetsSize;
+  unsigned int first;
+  unsigned int count;
+  unsigned int firstId;
+  unsigned int maxEntries;
+  consolehckTrigramIndex* index;
+} consolehckHistory;
+
+// Node of a prefix trie over codepoint strings. Children are linked through sibling in codepoint order,
+// index 0 is the root and doubles as "none". count is the number of strings ending in the subtree.
+typedef struct consolehckTrieNode {
+  unsigned int codepoint;
+  unsigned int child;
+  unsigned int sibling;
+  unsigned int count;
+  int terminal;
+} consolehckTrieNode;
+
+typedef struct consolehckTrie {
+  consolehckTrieNode* nodes;
+  unsigned int size;
+  unsigned int num;
+} consolehckTrie;
+
+// Completion candidates for prefix, each zero-terminated in text and in the order they were added.
+// common is the length of the longest prefix all candidates share.
+typedef struct consolehckCompletions {
   consolehckStringBuffer* text;
+  unsigned int count;
+  unsigned int common;
+  unsigned int const* prefix;
+  unsigned int prefixLength;
+} consolehckCompletions;
+
+// Argument completer signature, adds candidates for the last token argv[argc - 1], which may be empty
+typedef void (* consolehckArgumentCompleter)(struct consolehckConsole*, unsigned int const*, unsigned int const argc, consolehckToken const* argv, consolehckCompletions*);
+
+typedef struct consolehckCommand {
+  unsigned int* name;
+  unsigned int length;
+  unsigned int hash;
+  consolehckCommandCallback callback;
+  consolehckArgumentCompleter completer;
+} consolehckCommand;
+
+// Commands by name in an open-addressed hash table, slots with a NULL name are free.
+// The names are also kept in a trie for completion.
+typedef struct consolehckCommands {
+  consolehckCommand* slots;
+  unsigned int size;
+  unsigned int count;
+  consolehckTrie* names;
+} consolehckCommands;
+
+typedef struct consolehckTextArea {
+  consolehckScrollback* text;
   int offset;
+  char* find; // Query being searched for, NULL when not searching
+  unsigned int findLength;
+  int found;
+  unsigned int foundLineId; // Line id of the current match, stays valid while lines are dropped
+  unsigned int foundStart;
 } consolehckTextArea;
 
 typedef struct consolehckInputLine {
   consolehckStringBuffer* prompt;
-  consolehckStringBuffer* input;
+  consolehckGapBuffer* input;
+  unsigned int scroll; // First visible input codepoint, kept between frames
+  consolehckHistory* history;
+  unsigned int historyPosition; // Entry shown while navigating, history->count when not navigating
+  consolehckStringBuffer* draft; // Line being edited before navigation started
+  int searching;
+  consolehckStringBuffer* searchQuery;
+  unsigned int searchMatch; // Matching entry, history->count when there is none
 } consolehckInputLine;
 
+#define CONSOLEHCK_GLYPH_CACHE_DIRECT 256
+
+// Where glyph advances come from, so layout needs no renderer. advance returns the pen advance of a codepoint.
+typedef struct consolehckFontMetrics {
+  float (* advance)(void* userData, unsigned int const fontId, unsigned int const fontSize, unsigned int const codepoint);
+  void* userData;
+} consolehckFontMetrics;
+
+// Advance widths of codepoints for one (fontId, fontSize) pair, measured once through the font metrics.
+// Codepoints below CONSOLEHCK_GLYPH_CACHE_DIRECT are looked up directly, the rest are hashed.
+// A fixed-width font has a cellWidth and its advances are computed from column counts instead.
+typedef struct consolehckGlyphCache {
+  consolehckFontMetrics metrics;
+  consolehckStats* stats; // Where measuring is counted, NULL when not collecting
+  unsigned int fontId;
+  unsigned int fontSize;
+  consolehckFontSpacing spacing;
+  float cellWidth; // Advance of a single column glyph when the font is fixed-width, 0 when it is proportional
+  float direct[CONSOLEHCK_GLYPH_CACHE_DIRECT];
+  unsigned int* codepoints;
+  float* advances;
+  unsigned int size;
+  unsigned int count;
+} consolehckGlyphCache;
+
+// Text placed at x, y (baseline of the row) in a layout, text + start is zero-terminated
+typedef struct consolehckGlyphRun {
+  float x;
+  float y;
+  unsigned int start;
+  unsigned int length;
+} consolehckGlyphRun;
+
+// Runs of one color with their texts back to back
+typedef struct consolehckGlyphBatch {
+  glhckColorb color;
+  consolehckGlyphRun* runs;
+  unsigned int numRuns;
+  unsigned int runsSize;
+  char* text;
+  unsigned int textLength;
+  unsigned int textSize;
+} consolehckGlyphBatch;
+
+// Positioned glyph runs in one font batched by color, ready for a backend to draw.
+// Batches past numBatches keep their buffers for the next layout.
+typedef struct consolehckLayout {
+  consolehckStats* stats; // Where laying out and drawing is counted, NULL when not collecting
+  unsigned int fontId;
+  unsigned int fontSize;
+  consolehckGlyphBatch* batches;
+  unsigned int numBatches;
+  unsigned int batchesSize;
+} consolehckLayout;
+
+// Lock-free queue any thread can push output into, drained into the scrollback on the render thread.
+// Opaque since it is built on C11 atomics.
+typedef struct consolehckQueue consolehckQueue;
+
 typedef struct consolehckConsole {
   consolehckTextArea output;
   consolehckInputLine input;
   consolehckInputCallback* inputCallbacks;
   unsigned int numInputCallbacks;
+  unsigned int inputCallbacksSize;
+  consolehckCommands* commands;
+  consolehckToken* tokens;
+  unsigned int tokensSize;
+  consolehckCompletions* completions;
 
   glhckText* text;
+  consolehckGlyphCache* glyphs;
+  consolehckLayout* layout;
+  consolehckQueue* queue;
   unsigned int fontId;
   unsigned int fontSize;
   float margin;
   glhckObject* object;
+
+  glhckFramebuffer* frameBuffer;
+  glhckObject* inputBackground;
+  glhckObject* promptBackground;
+  unsigned int promptBackgroundHeight;
+  glhckColorb backgroundColor;
+  glhckColorb promptBackgroundColor;
+  glhckColorb textColor;
+  glhckColorb highlightColor;
+  unsigned int dirty;
+  consolehckUpdateMode updateMode;
+  double updateInterval;
+  double lastRenderTime;
+  consolehckStats* stats; // NULL unless enabled with consolehckConsoleStatsEnable
 } consolehckConsole;
 
 consolehckConsole* consolehckConsoleNew(float const width, float const height);
 void consolehckConsoleFree(consolehckConsole* console);
 
+// Update renders the whole console, Refresh only the parts marked dirty and nothing when clean
 void consolehckConsoleUpdate(consolehckConsole* console);
+void consolehckConsoleRefresh(consolehckConsole* console);
+void consolehckConsoleUpdateMode(consolehckConsole* console, consolehckUpdateMode const mode, double const minInterval);
+// Flush renders now, Tick only once minInterval has passed since the last render by either of them
+void consolehckConsoleFlush(consolehckConsole* console, double const time);
+void consolehckConsoleTick(consolehckConsole* console, double const time);
 void consolehckConsoleFont(consolehckConsole* console, char const* filename);
+void consolehckConsoleBackgroundColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a);
+void consolehckConsolePromptBackgroundColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a);
 void consolehckConsoleFontSize(consolehckConsole* console, const unsigned int fontSize);
+// Tells the console whether its font is fixed-width or has it detected, which is the default
+void consolehckConsoleFontSpacing(consolehckConsole* console, consolehckFontSpacing const spacing);
+
+// Per-phase timers and counters of the work done by Update, Refresh, Flush and Tick. Collecting is off by default,
+// consolehckConsoleStats copies them into stats and returns 0 when it is off.
+void consolehckConsoleStatsEnable(consolehckConsole* console, int const enabled);
+int consolehckConsoleStats(consolehckConsole const* console, consolehckStats* stats);
+void consolehckConsoleStatsReset(consolehckConsole* console);
+// Memory accounting by component, Trim gives back the capacity buffers, arenas and scratch space hold beyond their contents
+void consolehckConsoleMemoryUsage(consolehckConsole const* console, consolehckMemoryUsage* usage);
+void consolehckConsoleTrim(consolehckConsole* console);
 
 void consolehckConsoleOutputChar(consolehckConsole* console, char const c);
 void consolehckConsoleOutputUnicodeChar(consolehckConsole* console, unsigned int const c);
 void consolehckConsoleOutputString(consolehckConsole* console, char const* c);
+void consolehckConsoleOutputStringN(consolehckConsole* console, char const* c, unsigned int const length);
 void consolehckConsoleOutputUnicodeString(consolehckConsole* console, unsigned int const* c);
+void consolehckConsoleOutputUnicodeStringN(consolehckConsole* console, unsigned int const* c, unsigned int const num);
+void consolehckConsoleOutputQueued(consolehckConsole* console, char const* c);
+void consolehckConsoleOutputQueuedN(consolehckConsole* console, char const* c, unsigned int const length);
+void consolehckConsoleOutputFormat(consolehckConsole* console, char const* format, ...);
+void consolehckConsoleOutputFormatV(consolehckConsole* console, char const* format, va_list args);
 
+void consolehckConsoleOutputLimit(consolehckConsole* console, unsigned int const maxLines, unsigned int const maxBytes);
 void consolehckConsoleOutputOffset(consolehckConsole* console, int const offset);
 int consolehckConsoleOutputGetOffset(consolehckConsole* console);
+// Highlights query in the output and scrolls to its newest match, the index this needs is built on first use
+int consolehckConsoleOutputFind(consolehckConsole* console, char const* query);
+int consolehckConsoleOutputFindN(consolehckConsole* console, char const* query, unsigned int const length);
+int consolehckConsoleOutputFindPrevious(consolehckConsole* console);
+int consolehckConsoleOutputFindNext(consolehckConsole* console);
+void consolehckConsoleOutputFindEnd(consolehckConsole* console);
+// Style of the output that follows, queued output can change it with SGR escapes instead
+void consolehckConsoleOutputStyle(consolehckConsole* console, consolehckStyle const* style);
+void consolehckConsoleOutputColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a);
+void consolehckConsoleOutputStyleReset(consolehckConsole* console);
+void consolehckConsoleHighlightColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a);
 
 void consolehckConsoleInputClear(consolehckConsole* console);
 void consolehckConsoleInputChar(consolehckConsole* console, char const c);
 void consolehckConsoleInputUnicodeChar(consolehckConsole* console, unsigned int const c);
 void consolehckConsoleInputString(consolehckConsole* console, char const* c);
+void consolehckConsoleInputStringN(consolehckConsole* console, char const* c, unsigned int const length);
 void consolehckConsoleInputUnicodeString(consolehckConsole* console, unsigned int const* c);
+void consolehckConsoleInputUnicodeStringN(consolehckConsole* console, unsigned int const* c, unsigned int const num);
 char consolehckConsoleInputPopChar(consolehckConsole* console);
 unsigned int consolehckConsoleInputPopUnicodeChar(consolehckConsole* console);
+unsigned int consolehckConsoleInputDelete(consolehckConsole* console);
+
+void consolehckConsoleInputCursor(consolehckConsole* console, unsigned int const position);
+unsigned int consolehckConsoleInputGetCursor(consolehckConsole* console);
+void consolehckConsoleInputCursorLeft(consolehckConsole* console);
+void consolehckConsoleInputCursorRight(consolehckConsole* console);
+void consolehckConsoleInputCursorWordLeft(consolehckConsole* console);
+void consolehckConsoleInputCursorWordRight(consolehckConsole* console);
+void consolehckConsoleInputCursorHome(consolehckConsole* console);
+void consolehckConsoleInputCursorEnd(consolehckConsole* console);
 
 void consolehckConsoleInputPrompt(consolehckConsole* console, char const* c);
+void consolehckConsoleInputPromptN(consolehckConsole* console, char const* c, unsigned int const length);
 void consolehckConsoleInputPromptUnicode(consolehckConsole* console, unsigned int const* c);
+void consolehckConsoleInputPromptUnicodeN(consolehckConsole* console, unsigned int const* c, unsigned int const num);
+
+void consolehckConsoleInputHistoryPrevious(consolehckConsole* console);
+void consolehckConsoleInputHistoryNext(consolehckConsole* console);
+void consolehckConsoleInputHistoryLimit(consolehckConsole* console, unsigned int const maxEntries);
+void consolehckConsoleInputSearch(consolehckConsole* console);
+void consolehckConsoleInputSearchEnd(consolehckConsole* console);
 
 void consolehckConsoleInputEnter(consolehckConsole* console);
 void consolehckConsoleInputCallbackRegister(consolehckConsole* console, consolehckInputCallback callback);
+// Commands run before the input callbacks, which only get the line if the command returns CONSOLEHCK_CONTINUE
+void consolehckConsoleCommandRegister(consolehckConsole* console, char const* name, consolehckCommandCallback callback);
+void consolehckConsoleCommandUnregister(consolehckConsole* console, char const* name);
+void consolehckConsoleCommandCompleter(consolehckConsole* console, char const* name, consolehckArgumentCompleter completer);
+// Completes the token before the cursor: expands it as far as the candidates agree and lists them otherwise
+void consolehckConsoleInputComplete(consolehckConsole* console);
 
 
 consolehckStringBuffer *consolehckStringBufferNew(unsigned int const initialSize);
@@ -84,15 +499,172 @@ void consolehckStringBufferFree(consolehckStringBuffer* buffer);
 consolehckStringBuffer* consolehckStringBufferCopy(consolehckStringBuffer const* buffer);
 void consolehckStringBufferResize(consolehckStringBuffer *buffer, unsigned int const newSize);
 void consolehckStringBufferClear(consolehckStringBuffer *buffer);
+void consolehckStringBufferTrim(consolehckStringBuffer* buffer);
+void consolehckStringBufferMemory(consolehckStringBuffer const* buffer, consolehckMemory* memory);
 
 void consolehckStringBufferPushChar(consolehckStringBuffer* buffer, char const c);
 void consolehckStringBufferPushUnicodeChar(consolehckStringBuffer* buffer, unsigned int const c);
 void consolehckStringBufferPushString(consolehckStringBuffer* buffer, char const* c);
+void consolehckStringBufferPushStringN(consolehckStringBuffer* buffer, char const* c, unsigned int const length);
 void consolehckStringBufferPushUnicodeString(consolehckStringBuffer* buffer, unsigned int const* c);
+void consolehckStringBufferPushUnicodeStringN(consolehckStringBuffer* buffer, unsigned int const* c, unsigned int const num);
 char consolehckStringBufferPopChar(consolehckStringBuffer* buffer);
 unsigned int consolehckStringBufferPopUnicodeChar(consolehckStringBuffer* buffer);
 
-void consolehckTextRenderUnicode(glhckText* textObject, glhckRect const* rect, int const offset, consolehckWrapMode wrapMode, unsigned int fontId, unsigned int fontSize, unsigned int const* const str);
+consolehckGapBuffer* consolehckGapBufferNew(unsigned int const initialSize);
+void consolehckGapBufferFree(consolehckGapBuffer* buffer);
+void consolehckGapBufferClear(consolehckGapBuffer* buffer);
+unsigned int consolehckGapBufferLength(consolehckGapBuffer const* buffer);
+unsigned int consolehckGapBufferCursor(consolehckGapBuffer const* buffer);
+unsigned int consolehckGapBufferGet(consolehckGapBuffer const* buffer, unsigned int const index);
+unsigned int const* consolehckGapBufferText(consolehckGapBuffer* buffer);
+void consolehckGapBufferMove(consolehckGapBuffer* buffer, unsigned int const position);
+void consolehckGapBufferInsertUnicodeStringN(consolehckGapBuffer* buffer, unsigned int const* c, unsigned int const num);
+void consolehckGapBufferInsertStringN(consolehckGapBuffer* buffer, char const* c, unsigned int const length);
+unsigned int consolehckGapBufferDeleteBackward(consolehckGapBuffer* buffer);
+unsigned int consolehckGapBufferDeleteForward(consolehckGapBuffer* buffer);
+unsigned int consolehckGapBufferWordLeft(consolehckGapBuffer const* buffer, unsigned int position);
+unsigned int consolehckGapBufferWordRight(consolehckGapBuffer const* buffer, unsigned int position);
+void consolehckGapBufferMemory(consolehckGapBuffer const* buffer, consolehckMemory* memory);
+void consolehckGapBufferTrim(consolehckGapBuffer* buffer);
+
+consolehckScrollback* consolehckScrollbackNew(unsigned int const initialSize);
+void consolehckScrollbackFree(consolehckScrollback* scrollback);
+void consolehckScrollbackLimit(consolehckScrollback* scrollback, unsigned int const maxLines, unsigned int const maxSize);
+void consolehckScrollbackClear(consolehckScrollback* scrollback);
+char consolehckScrollbackGet(consolehckScrollback const* scrollback, unsigned int const index);
+void consolehckScrollbackCopy(consolehckScrollback const* scrollback, unsigned int const index, unsigned int const num, char* result);
+unsigned int consolehckScrollbackLineCount(consolehckScrollback const* scrollback);
+consolehckLine* consolehckScrollbackGetLine(consolehckScrollback* scrollback, unsigned int const line);
+void consolehckScrollbackCopyLine(consolehckScrollback const* scrollback, unsigned int const line, char* result);
+// Text of a line followed by a byte that is not a UTF-8 continuation, in the ring or in a scratch line valid until the next call
+char const* consolehckScrollbackLineText(consolehckScrollback* scrollback, unsigned int const line);
+void consolehckScrollbackLayout(consolehckScrollback* scrollback, float const width, unsigned int const fontId, unsigned int const fontSize);
+void consolehckScrollbackInvalidateLayout(consolehckScrollback* scrollback);
+// Memory leaves out the search index, Trim shrinks the text, lines, spans and search index to their contents and releases scratch space
+void consolehckScrollbackMemory(consolehckScrollback const* scrollback, consolehckMemory* memory);
+void consolehckScrollbackTrim(consolehckScrollback* scrollback);
+
+void consolehckScrollbackPushChar(consolehckScrollback* scrollback, char const c);
+void consolehckScrollbackPushUnicodeChar(consolehckScrollback* scrollback, unsigned int const c);
+void consolehckScrollbackPushString(consolehckScrollback* scrollback, char const* c);
+void consolehckScrollbackPushStringN(consolehckScrollback* scrollback, char const* c, unsigned int const length);
+void consolehckScrollbackPushUnicodeString(consolehckScrollback* scrollback, unsigned int const* c);
+void consolehckScrollbackPushUnicodeStringN(consolehckScrollback* scrollback, unsigned int const* c, unsigned int num);
+void consolehckScrollbackPushFormatV(consolehckScrollback* scrollback, char const* format, va_list args);
+
+// Style of text pushed from now on. StyleAt returns the style of the byte at index, NULL for the default style,
+// and where the run of that style ends.
+void consolehckScrollbackStyle(consolehckScrollback* scrollback, consolehckStyle const* style);
+consolehckStyle const* consolehckScrollbackStyleAt(consolehckScrollback const* scrollback, unsigned int const index, unsigned int* end);
+
+// Find functions work without the search index too, scanning every line.
+// FindPrevious finds the newest match starting before (line, start), FindNext the oldest one at or after it.
+void consolehckScrollbackSearchIndex(consolehckScrollback* scrollback, int const enabled);
+int consolehckScrollbackFindPrevious(consolehckScrollback* scrollback, char const* query, unsigned int const length, unsigned int const line, unsigned int const start, consolehckMatch* match);
+int consolehckScrollbackFindNext(consolehckScrollback* scrollback, char const* query, unsigned int const length, unsigned int const line, unsigned int const start, consolehckMatch* match);
+unsigned int consolehckScrollbackFindAll(consolehckScrollback* scrollback, char const* query, unsigned int const length, consolehckMatch* matches, unsigned int const maxMatches);
+
+// ANSI SGR parameters ("1;31" of ESC[1;31m) applied to a style, and the color of an entry of the 256 color palette
+void consolehckAnsiApply(consolehckStyle* style, char const* parameters, unsigned int const length);
+glhckColorb consolehckAnsiColor(unsigned int const index);
+
+consolehckGlyphCache* consolehckGlyphCacheNew(consolehckFontMetrics const* metrics);
+void consolehckGlyphCacheFree(consolehckGlyphCache* cache);
+void consolehckGlyphCacheClear(consolehckGlyphCache* cache);
+void consolehckGlyphCacheFont(consolehckGlyphCache* cache, unsigned int const fontId, unsigned int const fontSize);
+void consolehckGlyphCacheSpacing(consolehckGlyphCache* cache, consolehckFontSpacing const spacing);
+// Cells a codepoint takes in a fixed-width font: 2 for wide East Asian characters, 0 for combining marks, 1 otherwise
+unsigned int consolehckGlyphColumns(unsigned int const codepoint);
+float consolehckGlyphCacheAdvance(consolehckGlyphCache* cache, unsigned int const codepoint);
+float consolehckGlyphCacheWidth(consolehckGlyphCache* cache, unsigned int const* codepoints, unsigned int const num);
+float consolehckGlyphCacheStringWidth(consolehckGlyphCache* cache, char const* text, unsigned int const length);
+unsigned int consolehckGlyphCacheWrap(consolehckGlyphCache* cache, char const* text, unsigned int const length, float const width, unsigned int* rowStarts, unsigned int const maxRows);
+void consolehckGlyphCacheMemory(consolehckGlyphCache const* cache, consolehckMemory* memory);
+
+consolehckTrigramIndex* consolehckTrigramIndexNew(void);
+void consolehckTrigramIndexFree(consolehckTrigramIndex* index);
+void consolehckTrigramIndexClear(consolehckTrigramIndex* index);
+void consolehckTrigramIndexAdd(consolehckTrigramIndex* index, unsigned int const id, char const* c, unsigned int const length);
+void consolehckTrigramIndexPrune(consolehckTrigramIndex* index, unsigned int const minId);
+void consolehckTrigramIndexTrim(consolehckTrigramIndex* index);
+int consolehckTrigramIndexRarest(consolehckTrigramIndex const* index, char const* query, unsigned int const length, unsigned int const** postings, unsigned int* num);
+void consolehckTrigramIndexMemory(consolehckTrigramIndex const* index, consolehckMemory* memory);
+
+consolehckHistory* consolehckHistoryNew(unsigned int const maxEntries);
+void consolehckHistoryFree(consolehckHistory* history);
+void consolehckHistoryClear(consolehckHistory* history);
+void consolehckHistoryLimit(consolehckHistory* history, unsigned int const maxEntries);
+unsigned int consolehckHistoryCount(consolehckHistory const* history);
+char const* consolehckHistoryGet(consolehckHistory const* history, unsigned int const index, unsigned int* length);
+void consolehckHistoryPush(consolehckHistory* history, char const* c, unsigned int const length);
+int consolehckHistorySearch(consolehckHistory const* history, char const* query, unsigned int const length, unsigned int const before);
+// Leaves out the search index
+void consolehckHistoryMemory(consolehckHistory const* history, consolehckMemory* memory);
+void consolehckHistoryTrim(consolehckHistory* history);
+
+consolehckCommands* consolehckCommandsNew(void);
+void consolehckCommandsFree(consolehckCommands* commands);
+void consolehckCommandsRegister(consolehckCommands* commands, char const* name, consolehckCommandCallback callback);
+void consolehckCommandsUnregister(consolehckCommands* commands, char const* name);
+consolehckCommand const* consolehckCommandsFind(consolehckCommands const* commands, unsigned int const* name, unsigned int const length);
+void consolehckCommandsCompleter(consolehckCommands* commands, char const* name, consolehckArgumentCompleter completer);
+void consolehckCommandsMemory(consolehckCommands const* commands, consolehckMemory* memory);
+unsigned int consolehckTokenize(unsigned int const* c, unsigned int const length, consolehckToken* tokens, unsigned int const maxTokens);
+
+consolehckTrie* consolehckTrieNew(void);
+void consolehckTrieFree(consolehckTrie* trie);
+void consolehckTrieInsert(consolehckTrie* trie, unsigned int const* c, unsigned int const length);
+void consolehckTrieRemove(consolehckTrie* trie, unsigned int const* c, unsigned int const length);
+unsigned int consolehckTrieComplete(consolehckTrie const* trie, consolehckCompletions* completions);
+void consolehckTrieMemory(consolehckTrie const* trie, consolehckMemory* memory);
+
+consolehckCompletions* consolehckCompletionsNew(void);
+void consolehckCompletionsFree(consolehckCompletions* completions);
+void consolehckCompletionsReset(consolehckCompletions* completions, unsigned int const* prefix, unsigned int const length);
+void consolehckCompletionsAdd(consolehckCompletions* completions, unsigned int const* c, unsigned int const num);
+void consolehckCompletionsAddString(consolehckCompletions* completions, char const* c);
+void consolehckCompletionsMemory(consolehckCompletions const* completions, consolehckMemory* memory);
+
+// Thread-safe, each push arrives in the scrollback whole and in order with the pushing thread's other messages.
+// Threads that pushed should call consolehckQueueThreadRelease before exiting to give back their slab.
+consolehckQueue* consolehckQueueNew(void);
+void consolehckQueueFree(consolehckQueue* queue);
+void consolehckQueuePush(consolehckQueue* queue, char const* c, unsigned int const length);
+unsigned int consolehckQueueDrain(consolehckQueue* queue, consolehckScrollback* scrollback);
+void consolehckQueueThreadRelease(void);
+
+void consolehckStatsReset(consolehckStats* stats);
+unsigned long long consolehckStatsClock(void);
+// Begin returns the time to pass to End, both do nothing when stats is NULL
+unsigned long long consolehckStatsBegin(consolehckStats const* stats);
+void consolehckStatsEnd(consolehckStats* stats, consolehckPhase const phase, unsigned long long const begin);
+void consolehckStatsAllocated(consolehckStats* stats, unsigned long long const bytes);
+
+consolehckLayout* consolehckLayoutNew(void);
+void consolehckLayoutFree(consolehckLayout* layout);
+// Empties the layout for runs in another font, keeping its buffers
+void consolehckLayoutReset(consolehckLayout* layout, unsigned int const fontId, unsigned int const fontSize);
+void consolehckLayoutAdd(consolehckLayout* layout, glhckColorb const color, float const x, float const y, char const* c, unsigned int const length);
+// Lays out the visible rows of the text in rect scrolled up by offset pixels, styled and highlighted as colors say
+void consolehckLayoutOutput(consolehckLayout* layout, consolehckGlyphCache* glyphs, glhckRect const* rect, int const offset, consolehckWrapMode wrapMode, consolehckScrollback* text, consolehckTextColors const* colors);
+// Lays out the prompt at x, y and as much of the input after it as fits before right, scrolled so the cursor shows
+void consolehckLayoutInput(consolehckLayout* layout, consolehckGlyphCache* glyphs, float const x, float const y, float const right,
+                           char const* prompt, unsigned int const promptLength, consolehckGapBuffer* input, unsigned int* scroll, glhckColorb const color);
+void consolehckLayoutMemory(consolehckLayout const* layout, consolehckMemory* memory);
+// Keeps only the buffers of the last layout, at its size
+void consolehckLayoutTrim(consolehckLayout* layout);
+// Metrics without a font for tests and benchmarks, every glyph is half the font size wide
+consolehckFontMetrics consolehckNullFontMetrics(void);
+
+// glhck backend: font metrics measured through a text object and layouts drawn with it
+consolehckFontMetrics consolehckGlhckFontMetrics(glhckText* text);
+void consolehckGlhckDraw(glhckText* text, consolehckLayout const* layout);
+
+// Lays out the text and draws it with glhck in one go, see consolehckLayoutOutput
+void consolehckTextRenderUnicode(glhckText* textObject, consolehckGlyphCache* glyphs, glhckRect const* rect, int const offset, consolehckWrapMode wrapMode, unsigned int fontId, unsigned int fontSize, consolehckScrollback* text, consolehckTextColors const* colors);
+// Row of a byte in a line counted up from the bottom row of the text, which is row 1
+unsigned int consolehckTextRowOf(consolehckGlyphCache* glyphs, float const width, unsigned int fontId, unsigned int fontSize, consolehckScrollback* text, unsigned int const line, unsigned int const byte);
 
 #ifdef __cplusplus
 }
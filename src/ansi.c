@@ -0,0 +1,158 @@
+#include "consolehck.h"
+
+#include <string.h>
+
+#define ANSI_MAX_PARAMETERS 16
+
+static unsigned char const ANSI_BASIC_COLORS[16][3] = {
+  {0, 0, 0}, {205, 0, 0}, {0, 205, 0}, {205, 205, 0}, {0, 0, 238}, {205, 0, 205}, {0, 205, 205}, {229, 229, 229},
+  {127, 127, 127}, {255, 0, 0}, {0, 255, 0}, {255, 255, 0}, {92, 92, 255}, {255, 0, 255}, {0, 255, 255}, {255, 255, 255}
+};
+
+static unsigned char const ANSI_CUBE_LEVELS[6] = {0, 95, 135, 175, 215, 255};
+
+static int consolehckAnsiExtendedColor(unsigned int const* parameters, unsigned int const num, unsigned int* i, glhckColorb* color);
+
+void consolehckAnsiApply(consolehckStyle* style, char const* parameters, unsigned int const length)
+{
+  /* Parameters are decimal numbers separated by semicolons, colons are taken as separators too.
+   * Missing numbers count as 0, so an empty parameter list resets the style.
+   * Unknown codes are skipped, a malformed extended color ends the sequence.
+   */
+  unsigned int values[ANSI_MAX_PARAMETERS];
+  unsigned int num = 0;
+  unsigned int value = 0;
+  unsigned int i;
+  for(i = 0; i <= length; ++i)
+  {
+    if(i == length || parameters[i] == ';' || parameters[i] == ':')
+    {
+      if(num < ANSI_MAX_PARAMETERS)
+      {
+        values[num++] = value;
+      }
+      value = 0;
+    }
+    else if(parameters[i] >= '0' && parameters[i] <= '9' && value < 65536)
+    {
+      value = value * 10 + (parameters[i] - '0');
+    }
+  }
+
+  for(i = 0; i < num; ++i)
+  {
+    unsigned int const code = values[i];
+    if(code == 0)
+    {
+      memset(style, 0, sizeof(consolehckStyle));
+    }
+    else if(code == 1)
+    {
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_BOLD;
+    }
+    else if(code == 2)
+    {
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_DIM;
+    }
+    else if(code == 3)
+    {
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_ITALIC;
+    }
+    else if(code == 4)
+    {
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_UNDERLINE;
+    }
+    else if(code == 7)
+    {
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_INVERSE;
+    }
+    else if(code == 22)
+    {
+      style->attributes &= ~(CONSOLEHCK_ATTRIBUTE_BOLD | CONSOLEHCK_ATTRIBUTE_DIM);
+    }
+    else if(code == 23)
+    {
+      style->attributes &= ~CONSOLEHCK_ATTRIBUTE_ITALIC;
+    }
+    else if(code == 24)
+    {
+      style->attributes &= ~CONSOLEHCK_ATTRIBUTE_UNDERLINE;
+    }
+    else if(code == 27)
+    {
+      style->attributes &= ~CONSOLEHCK_ATTRIBUTE_INVERSE;
+    }
+    else if((code >= 30 && code <= 37) || (code >= 90 && code <= 97))
+    {
+      style->foreground = consolehckAnsiColor(code >= 90 ? code - 90 + 8 : code - 30);
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_FOREGROUND;
+    }
+    else if((code >= 40 && code <= 47) || (code >= 100 && code <= 107))
+    {
+      style->background = consolehckAnsiColor(code >= 100 ? code - 100 + 8 : code - 40);
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_BACKGROUND;
+    }
+    else if(code == 38)
+    {
+      if(!consolehckAnsiExtendedColor(values, num, &i, &style->foreground))
+        return;
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_FOREGROUND;
+    }
+    else if(code == 48)
+    {
+      if(!consolehckAnsiExtendedColor(values, num, &i, &style->background))
+        return;
+      style->attributes |= CONSOLEHCK_ATTRIBUTE_BACKGROUND;
+    }
+    else if(code == 39)
+    {
+      style->foreground = (glhckColorb) {0, 0, 0, 0};
+      style->attributes &= ~CONSOLEHCK_ATTRIBUTE_FOREGROUND;
+    }
+    else if(code == 49)
+    {
+      style->background = (glhckColorb) {0, 0, 0, 0};
+      style->attributes &= ~CONSOLEHCK_ATTRIBUTE_BACKGROUND;
+    }
+  }
+}
+
+glhckColorb consolehckAnsiColor(unsigned int const index)
+{
+  // 16 basic colors, a 6x6x6 color cube and a ramp of 24 grays
+  if(index < 16)
+  {
+    return (glhckColorb) {ANSI_BASIC_COLORS[index][0], ANSI_BASIC_COLORS[index][1], ANSI_BASIC_COLORS[index][2], 255};
+  }
+  else if(index < 232)
+  {
+    unsigned int const cube = index - 16;
+    return (glhckColorb) {ANSI_CUBE_LEVELS[cube / 36], ANSI_CUBE_LEVELS[cube / 6 % 6], ANSI_CUBE_LEVELS[cube % 6], 255};
+  }
+
+  unsigned char const gray = index < 256 ? 8 + (index - 232) * 10 : 255;
+  return (glhckColorb) {gray, gray, gray, 255};
+}
+
+static int consolehckAnsiExtendedColor(unsigned int const* parameters, unsigned int const num, unsigned int* i, glhckColorb* color)
+{
+  // 38 and 48 are followed by 5;index or 2;r;g;b, *i is left on the last parameter consumed
+  if(*i + 2 < num && parameters[*i + 1] == 5)
+  {
+    *color = consolehckAnsiColor(parameters[*i + 2]);
+    *i += 2;
+    return 1;
+  }
+
+  if(*i + 4 < num && parameters[*i + 1] == 2)
+  {
+    unsigned int const r = parameters[*i + 2];
+    unsigned int const g = parameters[*i + 3];
+    unsigned int const b = parameters[*i + 4];
+    *color = (glhckColorb) {r < 255 ? r : 255, g < 255 ? g : 255, b < 255 ? b : 255, 255};
+    *i += 4;
+    return 1;
+  }
+
+  return 0;
+}
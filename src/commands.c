@@ -0,0 +1,238 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+/* Commands are kept in an open-addressed table with linear probing, sized to a power of two and
+ * grown before it gets three quarters full. Names are stored decoded so input tokens can be looked
+ * up as they are, without encoding them first. Removal shifts the following entries of the probe
+ * run back instead of leaving tombstones.
+ */
+
+static unsigned int consolehckCommandsHash(unsigned int const* name, unsigned int const length);
+static consolehckCommand* consolehckCommandsSlot(consolehckCommands const* commands, unsigned int const* name, unsigned int const length, unsigned int const hash);
+static void consolehckCommandsGrow(consolehckCommands* commands);
+static int consolehckTokenIsSpace(unsigned int const c);
+
+consolehckCommands* consolehckCommandsNew(void)
+{
+  consolehckCommands* const commands = calloc(1, sizeof(consolehckCommands));
+  commands->size = 16;
+  commands->slots = calloc(commands->size, sizeof(consolehckCommand));
+  commands->count = 0;
+  commands->names = consolehckTrieNew();
+
+  return commands;
+}
+
+void consolehckCommandsFree(consolehckCommands* commands)
+{
+  unsigned int i;
+  for(i = 0; i < commands->size; ++i)
+  {
+    free(commands->slots[i].name);
+  }
+
+  free(commands->slots);
+  consolehckTrieFree(commands->names);
+  free(commands);
+}
+
+void consolehckCommandsRegister(consolehckCommands* commands, char const* name, consolehckCommandCallback callback)
+{
+  // Registering a name again replaces its callback
+  unsigned int* const decoded = calloc(strlen(name) + 1, sizeof(unsigned int));
+  unsigned int const length = utf8DecodeStringN(name, strlen(name), decoded);
+  unsigned int const hash = consolehckCommandsHash(decoded, length);
+
+  consolehckCommand* slot = consolehckCommandsSlot(commands, decoded, length, hash);
+  if(slot->name != NULL)
+  {
+    slot->callback = callback;
+    free(decoded);
+    return;
+  }
+
+  if((commands->count + 1) * 4 > commands->size * 3)
+  {
+    consolehckCommandsGrow(commands);
+    slot = consolehckCommandsSlot(commands, decoded, length, hash);
+  }
+
+  slot->name = decoded;
+  slot->length = length;
+  slot->hash = hash;
+  slot->callback = callback;
+  slot->completer = NULL;
+  commands->count += 1;
+  consolehckTrieInsert(commands->names, decoded, length);
+}
+
+void consolehckCommandsUnregister(consolehckCommands* commands, char const* name)
+{
+  unsigned int* const decoded = calloc(strlen(name) + 1, sizeof(unsigned int));
+  unsigned int const length = utf8DecodeStringN(name, strlen(name), decoded);
+  consolehckCommand* const slot = consolehckCommandsSlot(commands, decoded, length, consolehckCommandsHash(decoded, length));
+  free(decoded);
+
+  if(slot->name == NULL)
+    return;
+
+  consolehckTrieRemove(commands->names, slot->name, slot->length);
+  free(slot->name);
+  slot->name = NULL;
+  commands->count -= 1;
+
+  // Move later entries of the probe run into the hole unless that would put them before their home slot
+  unsigned int const mask = commands->size - 1;
+  unsigned int hole = slot - commands->slots;
+  unsigned int i = (hole + 1) & mask;
+  while(commands->slots[i].name != NULL)
+  {
+    unsigned int const home = commands->slots[i].hash & mask;
+    if(((i - home) & mask) >= ((i - hole) & mask))
+    {
+      commands->slots[hole] = commands->slots[i];
+      commands->slots[i].name = NULL;
+      hole = i;
+    }
+    i = (i + 1) & mask;
+  }
+}
+
+consolehckCommand const* consolehckCommandsFind(consolehckCommands const* commands, unsigned int const* name, unsigned int const length)
+{
+  consolehckCommand const* const slot = consolehckCommandsSlot(commands, name, length, consolehckCommandsHash(name, length));
+  return slot->name != NULL ? slot : NULL;
+}
+
+void consolehckCommandsCompleter(consolehckCommands* commands, char const* name, consolehckArgumentCompleter completer)
+{
+  // The command has to be registered already
+  unsigned int* const decoded = calloc(strlen(name) + 1, sizeof(unsigned int));
+  unsigned int const length = utf8DecodeStringN(name, strlen(name), decoded);
+  consolehckCommand* const slot = consolehckCommandsSlot(commands, decoded, length, consolehckCommandsHash(decoded, length));
+  free(decoded);
+
+  if(slot->name != NULL)
+  {
+    slot->completer = completer;
+  }
+}
+
+unsigned int consolehckTokenize(unsigned int const* c, unsigned int const length, consolehckToken* tokens, unsigned int const maxTokens)
+{
+  /* Splits at spaces and tabs, a token starting with a double quote runs to the next one and may
+   * contain whitespace. Spans exclude the quotes. Returns the number of tokens in the line,
+   * only the first maxTokens of which are stored.
+   */
+  unsigned int num = 0;
+  unsigned int i = 0;
+  while(i < length)
+  {
+    if(consolehckTokenIsSpace(c[i]))
+    {
+      ++i;
+      continue;
+    }
+
+    unsigned int start = i;
+    if(c[i] == '"')
+    {
+      start = ++i;
+      while(i < length && c[i] != '"')
+        ++i;
+    }
+    else
+    {
+      while(i < length && !consolehckTokenIsSpace(c[i]))
+        ++i;
+    }
+
+    if(num < maxTokens)
+    {
+      tokens[num].start = start;
+      tokens[num].length = i - start;
+    }
+    ++num;
+
+    // Step over the closing quote
+    if(i < length && c[i] == '"')
+      ++i;
+  }
+
+  return num;
+}
+
+void consolehckCommandsMemory(consolehckCommands const* commands, consolehckMemory* memory)
+{
+  memory->used += sizeof(consolehckCommands) + commands->count * sizeof(consolehckCommand);
+  memory->reserved += sizeof(consolehckCommands) + commands->size * sizeof(consolehckCommand);
+
+  unsigned int i;
+  for(i = 0; i < commands->size; ++i)
+  {
+    if(commands->slots[i].name != NULL)
+    {
+      memory->used += (commands->slots[i].length + 1) * sizeof(unsigned int);
+      memory->reserved += (commands->slots[i].length + 1) * sizeof(unsigned int);
+    }
+  }
+
+  consolehckTrieMemory(commands->names, memory);
+}
+
+static unsigned int consolehckCommandsHash(unsigned int const* name, unsigned int const length)
+{
+  // FNV-1a over the codepoints
+  unsigned int hash = 2166136261u;
+  unsigned int i;
+  for(i = 0; i < length; ++i)
+  {
+    hash = (hash ^ name[i]) * 16777619u;
+  }
+
+  return hash;
+}
+
+static consolehckCommand* consolehckCommandsSlot(consolehckCommands const* commands, unsigned int const* name, unsigned int const length, unsigned int const hash)
+{
+  // Slot holding name, or the free slot ending its probe run
+  unsigned int const mask = commands->size - 1;
+  unsigned int i = hash & mask;
+  while(commands->slots[i].name != NULL)
+  {
+    consolehckCommand* const slot = &commands->slots[i];
+    if(slot->hash == hash && slot->length == length && memcmp(slot->name, name, length * sizeof(unsigned int)) == 0)
+      return slot;
+    i = (i + 1) & mask;
+  }
+
+  return &commands->slots[i];
+}
+
+static void consolehckCommandsGrow(consolehckCommands* commands)
+{
+  consolehckCommand* const old = commands->slots;
+  unsigned int const oldSize = commands->size;
+  commands->size *= 2;
+  commands->slots = calloc(commands->size, sizeof(consolehckCommand));
+
+  unsigned int i;
+  for(i = 0; i < oldSize; ++i)
+  {
+    if(old[i].name != NULL)
+    {
+      *consolehckCommandsSlot(commands, old[i].name, old[i].length, old[i].hash) = old[i];
+    }
+  }
+
+  free(old);
+}
+
+static int consolehckTokenIsSpace(unsigned int const c)
+{
+  return c == ' ' || c == '\t';
+}
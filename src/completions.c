@@ -0,0 +1,75 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+consolehckCompletions* consolehckCompletionsNew(void)
+{
+  consolehckCompletions* const completions = calloc(1, sizeof(consolehckCompletions));
+  completions->text = consolehckStringBufferNew(64);
+  completions->count = 0;
+  completions->common = 0;
+  completions->prefix = NULL;
+  completions->prefixLength = 0;
+
+  return completions;
+}
+
+void consolehckCompletionsFree(consolehckCompletions* completions)
+{
+  consolehckStringBufferFree(completions->text);
+  free(completions);
+}
+
+void consolehckCompletionsReset(consolehckCompletions* completions, unsigned int const* prefix, unsigned int const length)
+{
+  // prefix has to stay valid until the candidates have been added
+  completions->text->length = 0;
+  completions->count = 0;
+  completions->common = 0;
+  completions->prefix = prefix;
+  completions->prefixLength = length;
+}
+
+void consolehckCompletionsAdd(consolehckCompletions* completions, unsigned int const* c, unsigned int const num)
+{
+  // Candidates not starting with the prefix are ignored, so completers may add everything they know
+  if(num < completions->prefixLength || memcmp(c, completions->prefix, completions->prefixLength * sizeof(unsigned int)) != 0)
+    return;
+
+  if(completions->count == 0)
+  {
+    completions->common = num;
+  }
+  else
+  {
+    unsigned int common = 0;
+    while(common < completions->common && common < num && completions->text->data[common] == c[common])
+    {
+      ++common;
+    }
+    completions->common = common;
+  }
+
+  consolehckStringBufferPushUnicodeStringN(completions->text, c, num);
+  consolehckStringBufferPushUnicodeChar(completions->text, 0);
+  completions->count += 1;
+}
+
+void consolehckCompletionsAddString(consolehckCompletions* completions, char const* c)
+{
+  unsigned int const length = strlen(c);
+  unsigned int* const decoded = calloc(length + 1, sizeof(unsigned int));
+  unsigned int const num = utf8DecodeStringN(c, length, decoded);
+  consolehckCompletionsAdd(completions, decoded, num);
+  free(decoded);
+}
+
+void consolehckCompletionsMemory(consolehckCompletions const* completions, consolehckMemory* memory)
+{
+  memory->used += sizeof(consolehckCompletions);
+  memory->reserved += sizeof(consolehckCompletions);
+  consolehckStringBufferMemory(completions->text, memory);
+}
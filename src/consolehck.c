@@ -3,23 +3,53 @@
 
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
 #include <stdio.h>
+#include <assert.h>
 
 unsigned int const UTF8_MAX_CHARS = 4;
-
-
+static char const SEARCH_PROMPT_BEGIN[] = "(reverse-i-search)`";
+static char const SEARCH_PROMPT_END[] = "': ";
+// Side of the glyph atlas of the text object, one byte per texel
+static int const TEXT_CACHE_SIZE = 1024;
+// Tokens a console starts with, enough for most command lines
+static unsigned int const TOKENS_SIZE = 8;
+
+static void consolehckConsoleRender(consolehckConsole* console);
+static void consolehckConsoleRenderInput(consolehckConsole* console, int const width, int const height);
+static void consolehckConsoleBackgroundsCreate(consolehckConsole* console, int const width);
+static void consolehckConsoleInputShowHistory(consolehckConsole* console, unsigned int const index);
+static void consolehckConsoleInputSearchUpdate(consolehckConsole* console, unsigned int const before);
+static unsigned int consolehckConsoleTokenize(consolehckConsole* console, unsigned int const* text, unsigned int const length);
+static void consolehckConsoleDrain(consolehckConsole* console);
+static void consolehckConsoleOutputJump(consolehckConsole* console, consolehckMatch const* match);
+static void consolehckStringBufferReserve(consolehckStringBuffer* buffer, unsigned int const num);
 
 
 consolehckConsole* consolehckConsoleNew(float const width, float const height)
 {
   consolehckConsole* console = calloc(1, sizeof(consolehckConsole));
 
-  console->input.input = consolehckStringBufferNew(128);
+  console->input.input = consolehckGapBufferNew(128);
   console->input.prompt = consolehckStringBufferNew(16);
-  console->output.text = consolehckStringBufferNew(1024);
+  console->input.history = consolehckHistoryNew(1000);
+  console->input.historyPosition = 0;
+  console->input.draft = consolehckStringBufferNew(16);
+  console->input.searching = 0;
+  console->input.searchQuery = consolehckStringBufferNew(16);
+  console->input.searchMatch = 0;
+  console->output.text = consolehckScrollbackNew(1024);
   console->output.offset = 0;
+  console->output.find = NULL;
+  console->output.findLength = 0;
+  console->output.found = 0;
   console->inputCallbacks = NULL;
   console->numInputCallbacks = 0;
+  console->inputCallbacksSize = 0;
+  console->commands = consolehckCommandsNew();
+  console->tokensSize = TOKENS_SIZE;
+  console->tokens = calloc(console->tokensSize, sizeof(consolehckToken));
+  console->completions = consolehckCompletionsNew();
   console->object = glhckPlaneNew(width, height);
 
   glhckTexture* consoleTexture = glhckTextureNew();
@@ -30,21 +60,58 @@ consolehckConsole* consolehckConsoleNew(float const width, float const height)
   glhckObjectMaterial(console->object, consoleMaterial);
   glhckMaterialFree(consoleMaterial);
 
-  console->text = glhckTextNew(1024,1024);
-  glhckTextColorb(console->text, 192, 192, 192, 255);
+  console->frameBuffer = glhckFramebufferNew(GLHCK_FRAMEBUFFER_DRAW);
+  glhckFramebufferRecti(console->frameBuffer, 0, 0, width, height);
+  glhckFramebufferAttachTexture(console->frameBuffer, consoleTexture, GLHCK_COLOR_ATTACHMENT0);
+
+  console->backgroundColor = (glhckColorb) {64, 64, 64, 255};
+  console->promptBackgroundColor = (glhckColorb) {0, 0, 0, 255};
+  console->promptBackground = NULL;
+  console->inputBackground = NULL;
+
+  console->text = glhckTextNew(TEXT_CACHE_SIZE, TEXT_CACHE_SIZE);
+  console->textColor = (glhckColorb) {192, 192, 192, 255};
+  console->highlightColor = (glhckColorb) {255, 208, 64, 255};
+  glhckTextColorb(console->text, console->textColor.r, console->textColor.g, console->textColor.b, console->textColor.a);
   console->fontSize = 14;
   console->fontId = glhckTextFontNewKakwafont(console->text, (int*)&console->fontSize);
+  consolehckFontMetrics const metrics = consolehckGlhckFontMetrics(console->text);
+  console->glyphs = consolehckGlyphCacheNew(&metrics);
+  consolehckGlyphCacheFont(console->glyphs, console->fontId, console->fontSize);
+  console->layout = consolehckLayoutNew();
+  console->queue = consolehckQueueNew();
   console->margin = 4;
+  consolehckConsoleBackgroundsCreate(console, width);
+  console->dirty = CONSOLEHCK_DIRTY_ALL;
+  console->updateMode = CONSOLEHCK_UPDATE_IMMEDIATE;
+  console->updateInterval = 0.0;
+  console->lastRenderTime = -1.0;
+  console->stats = NULL;
 
   return console;
 }
 
 void consolehckConsoleFree(consolehckConsole* console)
 {
-  consolehckStringBufferFree(console->input.input);
+  consolehckGapBufferFree(console->input.input);
   consolehckStringBufferFree(console->input.prompt);
-  consolehckStringBufferFree(console->output.text);
+  consolehckHistoryFree(console->input.history);
+  consolehckStringBufferFree(console->input.draft);
+  consolehckStringBufferFree(console->input.searchQuery);
+  consolehckQueueFree(console->queue);
+  consolehckScrollbackFree(console->output.text);
+  free(console->output.find);
   free(console->inputCallbacks);
+  consolehckCommandsFree(console->commands);
+  free(console->tokens);
+  consolehckCompletionsFree(console->completions);
+  consolehckGlyphCacheFree(console->glyphs);
+  consolehckLayoutFree(console->layout);
+  free(console->stats);
+  glhckTextFree(console->text);
+  glhckObjectFree(console->promptBackground);
+  glhckObjectFree(console->inputBackground);
+  glhckFramebufferFree(console->frameBuffer);
   glhckObjectFree(console->object);
   free(console);
 }
@@ -52,16 +119,71 @@ void consolehckConsoleFree(consolehckConsole* console)
 
 void consolehckConsoleUpdate(consolehckConsole* console)
 {
+  console->dirty = CONSOLEHCK_DIRTY_ALL;
+  consolehckConsoleRefresh(console);
+}
+
+void consolehckConsoleRefresh(consolehckConsole* console)
+{
+  consolehckConsoleDrain(console);
+
+  // Deferred consoles render from consolehckConsoleFlush or consolehckConsoleTick only
+  if(console->updateMode == CONSOLEHCK_UPDATE_DEFERRED)
+    return;
+
+  consolehckConsoleRender(console);
+}
+
+void consolehckConsoleUpdateMode(consolehckConsole* console, consolehckUpdateMode const mode, double const minInterval)
+{
+  console->updateMode = mode;
+  console->updateInterval = minInterval;
+}
+
+void consolehckConsoleFlush(consolehckConsole* console, double const time)
+{
+  consolehckConsoleDrain(console);
+  if(console->dirty == 0)
+    return;
+
+  // A flush counts as a render for the minimum interval of later ticks
+  console->lastRenderTime = time;
+  consolehckConsoleRender(console);
+}
+
+void consolehckConsoleTick(consolehckConsole* console, double const time)
+{
+  consolehckConsoleDrain(console);
+  if(console->dirty == 0)
+    return;
+
+  if(console->lastRenderTime >= 0.0 && time - console->lastRenderTime < console->updateInterval)
+    return;
+
+  console->lastRenderTime = time;
+  consolehckConsoleRender(console);
+}
+
+static void consolehckConsoleRender(consolehckConsole* console)
+{
+  if(console->dirty == 0)
+    return;
+
+  consolehckStats* const stats = console->stats;
+  unsigned long long const frameBegin = consolehckStatsBegin(stats);
+  unsigned long long begin = frameBegin;
 
   glhckTexture* consoleTexture = glhckMaterialGetTexture(glhckObjectGetMaterial(console->object));
   int width, height;
   glhckTextureGetInformation(consoleTexture, NULL, &width, &height, NULL, NULL, NULL, NULL);
 
-  glhckFramebuffer* const frameBuffer = glhckFramebufferNew(GLHCK_FRAMEBUFFER_DRAW);
-  glhckFramebufferRecti(frameBuffer, 0, 0, width, height);
-  glhckFramebufferAttachTexture(frameBuffer, consoleTexture, GLHCK_COLOR_ATTACHMENT0);
+  // The background planes are sized by the font, rebuild them only when the font size changes
+  if(console->promptBackgroundHeight != console->fontSize)
+  {
+    consolehckConsoleBackgroundsCreate(console, width);
+  }
 
-  glhckFramebufferBegin(frameBuffer);
+  glhckFramebufferBegin(console->frameBuffer);
 
   kmMat4 previousProjection = *glhckRenderGetProjection();
 
@@ -69,106 +191,433 @@ void consolehckConsoleUpdate(consolehckConsole* console)
   kmMat4OrthographicProjection(&ortho, 0, width, 0, height, -1, 1);
   glhckRenderProjectionOnly(&ortho);
 
-  glhckColorb const previousClearColor = *glhckRenderGetClearColor();
-  glhckRenderClearColorb(64, 64, 64, 255);
-  glhckRenderClear(GLHCK_COLOR_BUFFER_BIT);
-  glhckRenderClearColor(&previousClearColor);
+  if(console->dirty & (CONSOLEHCK_DIRTY_OUTPUT | CONSOLEHCK_DIRTY_OFFSET))
+  {
+    // Output changes repaint the whole texture, the input strip is drawn over the output area
+    glhckColorb const previousClearColor = *glhckRenderGetClearColor();
+    glhckRenderClearColor(&console->backgroundColor);
+    glhckRenderClear(GLHCK_COLOR_BUFFER_BIT);
+    glhckRenderClearColor(&previousClearColor);
+    consolehckStatsEnd(stats, CONSOLEHCK_PHASE_SETUP, begin);
+
+    glhckRect rect = {console->margin, console->margin, width - console->margin * 2, height - console->margin * 2};
+    consolehckTextColors const colors = {console->textColor, console->backgroundColor, console->output.find, console->output.findLength, console->highlightColor};
+    consolehckLayoutReset(console->layout, console->fontId, console->fontSize);
+    consolehckLayoutOutput(console->layout, console->glyphs, &rect, console->output.offset, CONSOLEHCK_WRAP, console->output.text, &colors);
+    consolehckGlhckDraw(console->text, console->layout);
+    begin = consolehckStatsBegin(stats);
+  }
+  else
+  {
+    // Only the input strip changed, cover the old one and leave the output area untouched
+    glhckObjectRender(console->inputBackground);
+  }
+
+  glhckObjectRender(console->promptBackground);
+  consolehckStatsEnd(stats, CONSOLEHCK_PHASE_SETUP, begin);
+  consolehckConsoleRenderInput(console, width, height);
 
-  glhckRect rect = {console->margin, console->margin, width - console->margin * 2, height - console->margin * 2};
-  consolehckTextRenderUnicode(console->text, &rect, console->output.offset, CONSOLEHCK_WRAP, console->fontId, console->fontSize, console->output.text->data);
-  glhckTextRender(console->text);
-  glhckTextClear(console->text);
+  begin = consolehckStatsBegin(stats);
+  glhckRenderProjectionOnly(&previousProjection);
 
-  glhckObject* promptBackground = glhckPlaneNew(width, console->fontSize);
-  glhckMaterial* promptBackgroundMaterial = glhckMaterialNew(NULL);
-  glhckMaterialDiffuseb(promptBackgroundMaterial, 0, 0, 0, 255);
-  glhckObjectMaterial(promptBackground, promptBackgroundMaterial);
-  glhckMaterialFree(promptBackgroundMaterial);
-  glhckObjectPositionf(promptBackground, width/2, console->fontSize/2 + console->margin, 0);
-  glhckObjectRender(promptBackground);
-  glhckObjectFree(promptBackground);
+  glhckFramebufferEnd(console->frameBuffer);
+  consolehckStatsEnd(stats, CONSOLEHCK_PHASE_SETUP, begin);
 
-  float const inputY = height - console->margin;
-  float promptRight = 0.0f;
+  console->dirty = 0;
 
-  if(console->input.prompt->length > 0)
+  if(stats != NULL)
   {
-    int utf8PromptLength = utf8EncodedStringLength(console->input.prompt->data);
-    char* utf8Prompt = calloc(utf8PromptLength + 1, 1);
-    utf8EncodeString(console->input.prompt->data, utf8Prompt);
-    glhckTextStash(console->text, console->fontId, console->fontSize, console->margin, inputY, utf8Prompt, &promptRight);
-    free(utf8Prompt);
+    unsigned long long const frameTime = consolehckStatsClock() - frameBegin;
+    stats->frames += 1;
+    stats->frameTime += frameTime;
+    stats->maxFrameTime = frameTime > stats->maxFrameTime ? frameTime : stats->maxFrameTime;
   }
+}
+
+static void consolehckConsoleRenderInput(consolehckConsole* console, int const width, int const height)
+{
+  unsigned long long const begin = consolehckStatsBegin(console->stats);
+  char* utf8Prompt = NULL;
+  unsigned int utf8PromptLength = 0;
+  if(console->input.searching)
+  {
+    // A search replaces the prompt with the query, the input shows the current match
+    consolehckStringBuffer const* const query = console->input.searchQuery;
+    int const utf8QueryLength = utf8EncodedStringLengthN(query->data, query->length);
+    utf8Prompt = calloc(utf8QueryLength + sizeof(SEARCH_PROMPT_BEGIN) + sizeof(SEARCH_PROMPT_END), 1);
+    strcpy(utf8Prompt, SEARCH_PROMPT_BEGIN);
+    utf8EncodeStringN(query->data, query->length, utf8Prompt + strlen(SEARCH_PROMPT_BEGIN));
+    strcat(utf8Prompt, SEARCH_PROMPT_END);
+    utf8PromptLength = strlen(utf8Prompt);
+  }
+  else if(console->input.prompt->length > 0)
+  {
+    utf8PromptLength = utf8EncodedStringLengthN(console->input.prompt->data, console->input.prompt->length);
+    utf8Prompt = calloc(utf8PromptLength + 1, 1);
+    utf8EncodeStringN(console->input.prompt->data, console->input.prompt->length, utf8Prompt);
+  }
+
+  if(utf8Prompt != NULL)
+  {
+    consolehckStatsAllocated(console->stats, utf8PromptLength + 1);
+  }
+  consolehckStatsEnd(console->stats, CONSOLEHCK_PHASE_ENCODE, begin);
+
+  consolehckLayoutReset(console->layout, console->fontId, console->fontSize);
+  consolehckLayoutInput(console->layout, console->glyphs, console->margin, height - console->margin, width,
+                        utf8Prompt, utf8PromptLength, console->input.input, &console->input.scroll, console->textColor);
+  consolehckGlhckDraw(console->text, console->layout);
+  free(utf8Prompt);
+}
+
+static void consolehckConsoleInputShowHistory(consolehckConsole* console, unsigned int const index)
+{
+  unsigned int length;
+  char const* const entry = consolehckHistoryGet(console->input.history, index, &length);
+  consolehckGapBufferClear(console->input.input);
+  consolehckGapBufferInsertStringN(console->input.input, entry, length);
+  console->dirty |= CONSOLEHCK_DIRTY_INPUT;
+}
 
-  if(console->input.input->length > 0)
+static void consolehckConsoleInputSearchUpdate(consolehckConsole* console, unsigned int const before)
+{
+  // Look for the newest entry below before that contains the query and show it
+  consolehckInputLine* const line = &console->input;
+  int const utf8QueryLength = utf8EncodedStringLengthN(line->searchQuery->data, line->searchQuery->length);
+  char* const utf8Query = calloc(utf8QueryLength + 1, 1);
+  utf8EncodeStringN(line->searchQuery->data, line->searchQuery->length, utf8Query);
+
+  int const match = consolehckHistorySearch(line->history, utf8Query, utf8QueryLength, before);
+  if(match >= 0)
   {
-    unsigned int visibleGlyphs = console->input.input->length;
-    unsigned int* inputUnicode = calloc(visibleGlyphs + 1, sizeof(unsigned int));
-    memcpy(inputUnicode, console->input.input->data, visibleGlyphs * sizeof(unsigned int));
-    int utf8InputLength = utf8EncodedStringLength(inputUnicode);
-    char* utf8Input = calloc(utf8InputLength + 1, 1);
-    utf8EncodeString(inputUnicode, utf8Input);
+    line->searchMatch = match;
+    consolehckConsoleInputShowHistory(console, match);
+  }
 
-    kmVec2 minv, maxv;
-    glhckTextGetMinMax(console->text, console->fontId, console->fontSize, utf8Input, &minv, &maxv);
+  free(utf8Query);
+  console->dirty |= CONSOLEHCK_DIRTY_PROMPT;
+}
 
-    unsigned int* inputLineStart = inputUnicode;
-    while(maxv.x > width - promptRight && *inputLineStart != 0)
+static unsigned int consolehckConsoleTokenize(consolehckConsole* console, unsigned int const* text, unsigned int const length)
+{
+  // Leaves at least one unused token behind the ones found
+  unsigned int argc = consolehckTokenize(text, length, console->tokens, console->tokensSize);
+  if(argc >= console->tokensSize)
+  {
+    while(console->tokensSize <= argc)
     {
-      ++inputLineStart;
-      memset(utf8Input, 0, utf8InputLength);
-      utf8EncodeString(inputLineStart, utf8Input);
-      glhckTextGetMinMax(console->text, console->fontId, console->fontSize, utf8Input, &minv, &maxv);
+      console->tokensSize *= 2;
     }
+    free(console->tokens);
+    console->tokens = calloc(console->tokensSize, sizeof(consolehckToken));
+    argc = consolehckTokenize(text, length, console->tokens, console->tokensSize);
+  }
+
+  return argc;
+}
+
+static void consolehckConsoleOutputJump(consolehckConsole* console, consolehckMatch const* match)
+{
+  // Make match the current one and scroll it to the middle of the output area
+  console->output.found = 1;
+  console->output.foundLineId = console->output.text->firstLineId + match->line;
+  console->output.foundStart = match->start;
+
+  glhckTexture* consoleTexture = glhckMaterialGetTexture(glhckObjectGetMaterial(console->object));
+  int width, height;
+  glhckTextureGetInformation(consoleTexture, NULL, &width, &height, NULL, NULL, NULL, NULL);
+
+  float const areaWidth = width - console->margin * 2;
+  int const visibleRows = (height - console->margin * 2) / console->fontSize;
+  int const row = consolehckTextRowOf(console->glyphs, areaWidth, console->fontId, console->fontSize, console->output.text, match->line, match->start);
+  int const rowsBelow = row - 1 - visibleRows / 2;
+
+  consolehckConsoleOutputOffset(console, rowsBelow > 0 ? rowsBelow * (int) console->fontSize : 0);
+}
 
-    glhckTextStash(console->text, console->fontId, console->fontSize, promptRight, inputY, utf8Input, NULL);
-    free(inputUnicode);
-    free(utf8Input);
+static void consolehckConsoleDrain(consolehckConsole* console)
+{
+  unsigned long long const begin = consolehckStatsBegin(console->stats);
+  if(consolehckQueueDrain(console->queue, console->output.text) > 0)
+  {
+    console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
   }
+  consolehckStatsEnd(console->stats, CONSOLEHCK_PHASE_DRAIN, begin);
+}
 
-  glhckTextRender(console->text);
-  glhckTextClear(console->text);
+static glhckObject* consolehckConsolePlaneNew(float const width, float const height, float const x, float const y, glhckColorb const* color)
+{
+  glhckObject* const plane = glhckPlaneNew(width, height);
+  glhckMaterial* const material = glhckMaterialNew(NULL);
+  glhckMaterialDiffuseb(material, color->r, color->g, color->b, color->a);
+  glhckObjectMaterial(plane, material);
+  glhckMaterialFree(material);
+  glhckObjectPositionf(plane, x, y, 0);
+
+  return plane;
+}
 
-  glhckRenderProjectionOnly(&previousProjection);
+static void consolehckConsoleBackgroundsCreate(consolehckConsole* console, int const width)
+{
+  if(console->promptBackground != NULL)
+  {
+    glhckObjectFree(console->promptBackground);
+    glhckObjectFree(console->inputBackground);
+  }
+
+  // The input strip spans from the bottom edge to the top of the prompt background
+  float const inputHeight = console->fontSize + console->margin;
+  console->inputBackground = consolehckConsolePlaneNew(width, inputHeight, width/2, inputHeight/2, &console->backgroundColor);
+  console->promptBackground = consolehckConsolePlaneNew(width, console->fontSize, width/2, console->fontSize/2 + console->margin, &console->promptBackgroundColor);
+  console->promptBackgroundHeight = console->fontSize;
+}
+
+void consolehckConsoleBackgroundColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a)
+{
+  console->backgroundColor = (glhckColorb) {r, g, b, a};
+  glhckMaterialDiffuseb(glhckObjectGetMaterial(console->inputBackground), r, g, b, a);
+  console->dirty = CONSOLEHCK_DIRTY_ALL;
+}
 
-  glhckFramebufferEnd(frameBuffer);
-  glhckFramebufferFree(frameBuffer);
+void consolehckConsolePromptBackgroundColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a)
+{
+  console->promptBackgroundColor = (glhckColorb) {r, g, b, a};
+  glhckMaterialDiffuseb(glhckObjectGetMaterial(console->promptBackground), r, g, b, a);
+  console->dirty |= CONSOLEHCK_DIRTY_PROMPT;
 }
 
 void consolehckConsoleFont(consolehckConsole* console, char const* filename)
 {
+  // The glyph cache finds out right away whether the font is fixed-width
   console->fontId = glhckTextFontNew(console->text, filename);
+  consolehckGlyphCacheFont(console->glyphs, console->fontId, console->fontSize);
+  console->dirty |= CONSOLEHCK_DIRTY_ALL;
 }
 
 void consolehckConsoleFontSize(consolehckConsole* console, unsigned int const fontSize)
 {
   console->fontSize = fontSize;
+  consolehckGlyphCacheFont(console->glyphs, console->fontId, console->fontSize);
+  console->dirty |= CONSOLEHCK_DIRTY_ALL;
+}
+
+void consolehckConsoleFontSpacing(consolehckConsole* console, consolehckFontSpacing const spacing)
+{
+  // Wrap points cached for the same font and size no longer hold
+  consolehckGlyphCacheSpacing(console->glyphs, spacing);
+  consolehckScrollbackInvalidateLayout(console->output.text);
+  console->dirty |= CONSOLEHCK_DIRTY_ALL;
+}
+
+
+void consolehckConsoleStatsEnable(consolehckConsole* console, int const enabled)
+{
+  if(enabled && console->stats == NULL)
+  {
+    console->stats = calloc(1, sizeof(consolehckStats));
+  }
+  else if(!enabled && console->stats != NULL)
+  {
+    free(console->stats);
+    console->stats = NULL;
+  }
+
+  console->glyphs->stats = console->stats;
+  console->layout->stats = console->stats;
+}
+
+int consolehckConsoleStats(consolehckConsole const* console, consolehckStats* stats)
+{
+  if(console->stats == NULL)
+  {
+    consolehckStatsReset(stats);
+    return 0;
+  }
+
+  *stats = *console->stats;
+  return 1;
+}
+
+void consolehckConsoleStatsReset(consolehckConsole* console)
+{
+  if(console->stats != NULL)
+  {
+    consolehckStatsReset(console->stats);
+  }
 }
 
+void consolehckConsoleMemoryUsage(consolehckConsole const* console, consolehckMemoryUsage* usage)
+{
+  memset(usage, 0, sizeof(consolehckMemoryUsage));
+
+  consolehckScrollbackMemory(console->output.text, &usage->output);
+  if(console->output.find != NULL)
+  {
+    usage->output.used += console->output.findLength + 1;
+    usage->output.reserved += console->output.findLength + 1;
+  }
+
+  consolehckGapBufferMemory(console->input.input, &usage->input);
+  consolehckStringBufferMemory(console->input.prompt, &usage->input);
+  consolehckStringBufferMemory(console->input.draft, &usage->input);
+  consolehckStringBufferMemory(console->input.searchQuery, &usage->input);
+  consolehckCompletionsMemory(console->completions, &usage->input);
+  usage->input.used += console->tokensSize * sizeof(consolehckToken);
+  usage->input.reserved += console->tokensSize * sizeof(consolehckToken);
+
+  usage->callbacks.used = console->numInputCallbacks * sizeof(consolehckInputCallback);
+  usage->callbacks.reserved = console->inputCallbacksSize * sizeof(consolehckInputCallback);
+  consolehckCommandsMemory(console->commands, &usage->callbacks);
+
+  consolehckHistoryMemory(console->input.history, &usage->history);
+  consolehckTrigramIndexMemory(console->input.history->index, &usage->indexes);
+  if(console->output.text->searchIndex != NULL)
+  {
+    consolehckTrigramIndexMemory(console->output.text->searchIndex, &usage->indexes);
+  }
+
+  consolehckGlyphCacheMemory(console->glyphs, &usage->layout);
+  consolehckLayoutMemory(console->layout, &usage->layout);
+
+  // Video memory is allocated whole, so used and reserved are the same
+  usage->glyphAtlas.used = (size_t) TEXT_CACHE_SIZE * TEXT_CACHE_SIZE;
+  usage->glyphAtlas.reserved = usage->glyphAtlas.used;
+
+  int width, height;
+  glhckTexture* consoleTexture = glhckMaterialGetTexture(glhckObjectGetMaterial(console->object));
+  glhckTextureGetInformation(consoleTexture, NULL, &width, &height, NULL, NULL, NULL, NULL);
+  usage->texture.used = (size_t) width * height * 4;
+  usage->texture.reserved = usage->texture.used;
+
+  consolehckMemory const* const components[] = {&usage->output, &usage->input, &usage->callbacks, &usage->history, &usage->indexes,
+                                                &usage->layout, &usage->glyphAtlas, &usage->texture};
+  unsigned int i;
+  for(i = 0; i < sizeof(components) / sizeof(components[0]); ++i)
+  {
+    usage->total.used += components[i]->used;
+    usage->total.reserved += components[i]->reserved;
+  }
+}
+
+void consolehckConsoleTrim(consolehckConsole* console)
+{
+  consolehckGapBufferTrim(console->input.input);
+  consolehckStringBufferTrim(console->input.prompt);
+  consolehckStringBufferTrim(console->input.draft);
+  consolehckStringBufferTrim(console->input.searchQuery);
+  consolehckStringBufferTrim(console->completions->text);
+  consolehckScrollbackTrim(console->output.text);
+  consolehckHistoryTrim(console->input.history);
+  consolehckLayoutTrim(console->layout);
+
+  // Tokens grow with the longest line entered, back to the size they start at
+  if(console->tokensSize > TOKENS_SIZE)
+  {
+    free(console->tokens);
+    console->tokensSize = TOKENS_SIZE;
+    console->tokens = calloc(console->tokensSize, sizeof(consolehckToken));
+  }
+}
 
 void consolehckConsoleOutputChar(consolehckConsole* console, char const c)
 {
-  consolehckStringBufferPushChar(console->output.text, c);
+  consolehckScrollbackPushChar(console->output.text, c);
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
 }
 
 void consolehckConsoleOutputUnicodeChar(consolehckConsole* console, unsigned int const c)
 {
-  consolehckStringBufferPushUnicodeChar(console->output.text, c);
+  consolehckScrollbackPushUnicodeChar(console->output.text, c);
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
 }
 
 void consolehckConsoleOutputString(consolehckConsole* console, char const* c)
 {
-  consolehckStringBufferPushString(console->output.text, c);
+  consolehckConsoleOutputStringN(console, c, strlen(c));
+}
+
+void consolehckConsoleOutputStringN(consolehckConsole* console, char const* c, unsigned int const length)
+{
+  consolehckScrollbackPushStringN(console->output.text, c, length);
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
 }
 
 void consolehckConsoleOutputUnicodeString(consolehckConsole* console, unsigned int const* c)
 {
-  consolehckStringBufferPushUnicodeString(console->output.text, c);
+  consolehckConsoleOutputUnicodeStringN(console, c, unicodeStringLength(c));
+}
+
+void consolehckConsoleOutputUnicodeStringN(consolehckConsole* console, unsigned int const* c, unsigned int const num)
+{
+  consolehckScrollbackPushUnicodeStringN(console->output.text, c, num);
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
+}
+
+void consolehckConsoleOutputQueued(consolehckConsole* console, char const* c)
+{
+  consolehckConsoleOutputQueuedN(console, c, strlen(c));
+}
+
+void consolehckConsoleOutputQueuedN(consolehckConsole* console, char const* c, unsigned int const length)
+{
+  // Safe from any thread, the render thread picks it up on its next refresh or tick
+  consolehckQueuePush(console->queue, c, length);
+}
+
+void consolehckConsoleOutputFormat(consolehckConsole* console, char const* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  consolehckConsoleOutputFormatV(console, format, args);
+  va_end(args);
+}
+
+void consolehckConsoleOutputFormatV(consolehckConsole* console, char const* format, va_list args)
+{
+  consolehckScrollbackPushFormatV(console->output.text, format, args);
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
+}
+
+void consolehckConsoleOutputLimit(consolehckConsole* console, unsigned int const maxLines, unsigned int const maxBytes)
+{
+  consolehckScrollbackLimit(console->output.text, maxLines, maxBytes);
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
+}
+
+void consolehckConsoleOutputStyle(consolehckConsole* console, consolehckStyle const* style)
+{
+  // Output still in the queue was written before the style changed
+  consolehckConsoleDrain(console);
+  consolehckScrollbackStyle(console->output.text, style);
+}
+
+void consolehckConsoleOutputColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a)
+{
+  consolehckStyle style = console->output.text->style;
+  style.foreground = (glhckColorb) {r, g, b, a};
+  style.attributes |= CONSOLEHCK_ATTRIBUTE_FOREGROUND;
+  consolehckConsoleOutputStyle(console, &style);
+}
+
+void consolehckConsoleOutputStyleReset(consolehckConsole* console)
+{
+  consolehckStyle const style = {{0, 0, 0, 0}, {0, 0, 0, 0}, 0};
+  consolehckConsoleOutputStyle(console, &style);
+}
+
+void consolehckConsoleHighlightColorb(consolehckConsole* console, unsigned char const r, unsigned char const g, unsigned char const b, unsigned char const a)
+{
+  console->highlightColor = (glhckColorb) {r, g, b, a};
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
 }
 
 void consolehckConsoleOutputOffset(consolehckConsole* console, int const offset)
 {
-  console->output.offset = offset;
+  if(console->output.offset != offset)
+  {
+    console->output.offset = offset;
+    console->dirty |= CONSOLEHCK_DIRTY_OFFSET;
+  }
 }
 
 int consolehckConsoleOutputGetOffset(consolehckConsole *console)
@@ -176,77 +625,463 @@ int consolehckConsoleOutputGetOffset(consolehckConsole *console)
   return console->output.offset;
 }
 
+int consolehckConsoleOutputFind(consolehckConsole* console, char const* query)
+{
+  return consolehckConsoleOutputFindN(console, query, strlen(query));
+}
+
+int consolehckConsoleOutputFindN(consolehckConsole* console, char const* query, unsigned int const length)
+{
+  // Every new query starts over from the newest output
+  free(console->output.find);
+  console->output.find = calloc(length + 1, sizeof(char));
+  memcpy(console->output.find, query, length);
+  console->output.findLength = length;
+  console->output.found = 0;
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
+
+  consolehckScrollbackSearchIndex(console->output.text, 1);
+
+  consolehckMatch match;
+  consolehckScrollback* const text = console->output.text;
+  if(!consolehckScrollbackFindPrevious(text, query, length, consolehckScrollbackLineCount(text), 0, &match))
+    return 0;
+
+  consolehckConsoleOutputJump(console, &match);
+  return 1;
+}
+
+int consolehckConsoleOutputFindPrevious(consolehckConsole* console)
+{
+  // Steps to the next older match, from the newest output when there is no current match
+  consolehckScrollback* const text = console->output.text;
+  if(console->output.find == NULL)
+    return 0;
+
+  unsigned int line = consolehckScrollbackLineCount(text);
+  unsigned int start = 0;
+  if(console->output.found)
+  {
+    if(console->output.foundLineId < text->firstLineId)
+      return 0;
+    line = console->output.foundLineId - text->firstLineId;
+    start = console->output.foundStart;
+  }
+
+  consolehckMatch match;
+  if(!consolehckScrollbackFindPrevious(text, console->output.find, console->output.findLength, line, start, &match))
+    return 0;
+
+  consolehckConsoleOutputJump(console, &match);
+  return 1;
+}
+
+int consolehckConsoleOutputFindNext(consolehckConsole* console)
+{
+  // Steps to the next newer match, from the oldest output when the current one has been dropped
+  consolehckScrollback* const text = console->output.text;
+  if(console->output.find == NULL || !console->output.found)
+    return 0;
+
+  unsigned int line = 0;
+  unsigned int start = 0;
+  if(console->output.foundLineId >= text->firstLineId)
+  {
+    line = console->output.foundLineId - text->firstLineId;
+    start = console->output.foundStart + 1;
+  }
+
+  consolehckMatch match;
+  if(!consolehckScrollbackFindNext(text, console->output.find, console->output.findLength, line, start, &match))
+    return 0;
+
+  consolehckConsoleOutputJump(console, &match);
+  return 1;
+}
+
+void consolehckConsoleOutputFindEnd(consolehckConsole* console)
+{
+  // The search index stays, it is kept up to date from here on
+  if(console->output.find == NULL)
+    return;
+
+  free(console->output.find);
+  console->output.find = NULL;
+  console->output.findLength = 0;
+  console->output.found = 0;
+  console->dirty |= CONSOLEHCK_DIRTY_OUTPUT;
+}
+
 
 
 void consolehckConsoleInputClear(consolehckConsole* console)
 {
-  consolehckStringBufferClear(console->input.input);
+  consolehckConsoleInputSearchEnd(console);
+  consolehckGapBufferClear(console->input.input);
+  console->dirty |= CONSOLEHCK_DIRTY_INPUT;
 }
 
 void consolehckConsoleInputChar(consolehckConsole* console, char const c)
 {
-  consolehckStringBufferPushChar(console->input.input, c);
+  consolehckConsoleInputStringN(console, &c, 1);
 }
 
 void consolehckConsoleInputUnicodeChar(consolehckConsole* console, unsigned int const c)
 {
-  consolehckStringBufferPushUnicodeChar(console->input.input, c);
+  consolehckConsoleInputUnicodeStringN(console, &c, 1);
 }
 
 void consolehckConsoleInputString(consolehckConsole* console, char const* c)
 {
-  consolehckStringBufferPushString(console->input.input, c);
+  consolehckConsoleInputStringN(console, c, strlen(c));
+}
+
+void consolehckConsoleInputStringN(consolehckConsole* console, char const* c, unsigned int const length)
+{
+  // Typing while searching extends the search query instead
+  if(console->input.searching)
+  {
+    consolehckStringBufferPushStringN(console->input.searchQuery, c, length);
+    consolehckConsoleInputSearchUpdate(console, console->input.searchMatch + 1);
+    return;
+  }
+
+  consolehckGapBufferInsertStringN(console->input.input, c, length);
+  console->dirty |= CONSOLEHCK_DIRTY_INPUT;
 }
 
 void consolehckConsoleInputUnicodeString(consolehckConsole* console, unsigned int const* c)
 {
-  consolehckStringBufferPushUnicodeString(console->input.input, c);
+  consolehckConsoleInputUnicodeStringN(console, c, unicodeStringLength(c));
+}
+
+void consolehckConsoleInputUnicodeStringN(consolehckConsole* console, unsigned int const* c, unsigned int const num)
+{
+  if(console->input.searching)
+  {
+    consolehckStringBufferPushUnicodeStringN(console->input.searchQuery, c, num);
+    consolehckConsoleInputSearchUpdate(console, console->input.searchMatch + 1);
+    return;
+  }
+
+  consolehckGapBufferInsertUnicodeStringN(console->input.input, c, num);
+  console->dirty |= CONSOLEHCK_DIRTY_INPUT;
 }
 
 char consolehckConsoleInputPopChar(consolehckConsole* console)
 {
-  return consolehckStringBufferPopChar(console->input.input);
+  unsigned int const codepoint = consolehckConsoleInputPopUnicodeChar(console);
+  if(codepoint == 0)
+    return '\0';
+
+  assert(utf8EncodedLength(codepoint) == 1);
+  char c;
+  utf8Encode(codepoint, &c, 1);
+  return c;
 }
 
 unsigned int consolehckConsoleInputPopUnicodeChar(consolehckConsole* console)
 {
-  return consolehckStringBufferPopUnicodeChar(console->input.input);
+  // While searching this shortens the query and looks for the newest match again
+  if(console->input.searching)
+  {
+    unsigned int const codepoint = consolehckStringBufferPopUnicodeChar(console->input.searchQuery);
+    consolehckConsoleInputSearchUpdate(console, consolehckHistoryCount(console->input.history));
+    return codepoint;
+  }
+
+  // Deletes the codepoint before the cursor
+  unsigned int const codepoint = consolehckGapBufferDeleteBackward(console->input.input);
+  if(codepoint != 0)
+  {
+    console->dirty |= CONSOLEHCK_DIRTY_INPUT;
+  }
+  return codepoint;
+}
+
+unsigned int consolehckConsoleInputDelete(consolehckConsole* console)
+{
+  consolehckConsoleInputSearchEnd(console);
+
+  // Deletes the codepoint under the cursor
+  unsigned int const codepoint = consolehckGapBufferDeleteForward(console->input.input);
+  if(codepoint != 0)
+  {
+    console->dirty |= CONSOLEHCK_DIRTY_INPUT;
+  }
+  return codepoint;
+}
+
+void consolehckConsoleInputCursor(consolehckConsole* console, unsigned int const position)
+{
+  consolehckConsoleInputSearchEnd(console);
+
+  unsigned int const length = consolehckGapBufferLength(console->input.input);
+  unsigned int const target = position < length ? position : length;
+  if(consolehckGapBufferCursor(console->input.input) == target)
+    return;
+
+  consolehckGapBufferMove(console->input.input, target);
+  console->dirty |= CONSOLEHCK_DIRTY_INPUT;
+}
+
+unsigned int consolehckConsoleInputGetCursor(consolehckConsole* console)
+{
+  return consolehckGapBufferCursor(console->input.input);
+}
+
+void consolehckConsoleInputCursorLeft(consolehckConsole* console)
+{
+  unsigned int const cursor = consolehckGapBufferCursor(console->input.input);
+  if(cursor > 0)
+  {
+    consolehckConsoleInputCursor(console, cursor - 1);
+  }
+}
+
+void consolehckConsoleInputCursorRight(consolehckConsole* console)
+{
+  consolehckConsoleInputCursor(console, consolehckGapBufferCursor(console->input.input) + 1);
+}
+
+void consolehckConsoleInputCursorWordLeft(consolehckConsole* console)
+{
+  consolehckConsoleInputCursor(console, consolehckGapBufferWordLeft(console->input.input, consolehckGapBufferCursor(console->input.input)));
+}
+
+void consolehckConsoleInputCursorWordRight(consolehckConsole* console)
+{
+  consolehckConsoleInputCursor(console, consolehckGapBufferWordRight(console->input.input, consolehckGapBufferCursor(console->input.input)));
+}
+
+void consolehckConsoleInputCursorHome(consolehckConsole* console)
+{
+  consolehckConsoleInputCursor(console, 0);
+}
+
+void consolehckConsoleInputCursorEnd(consolehckConsole* console)
+{
+  consolehckConsoleInputCursor(console, consolehckGapBufferLength(console->input.input));
 }
 
 void consolehckConsoleInputPrompt(consolehckConsole* console, char const* c)
+{
+  consolehckConsoleInputPromptN(console, c, strlen(c));
+}
+
+void consolehckConsoleInputPromptN(consolehckConsole* console, char const* c, unsigned int const length)
 {
   consolehckStringBufferClear(console->input.prompt);
-  consolehckStringBufferPushString(console->input.prompt, c);
+  consolehckStringBufferPushStringN(console->input.prompt, c, length);
+  console->dirty |= CONSOLEHCK_DIRTY_PROMPT;
+}
+
+void consolehckConsoleInputPromptUnicode(consolehckConsole* console, unsigned int const* c)
+{
+  consolehckConsoleInputPromptUnicodeN(console, c, unicodeStringLength(c));
 }
 
-void consolehckConsolePromptUnicode(consolehckConsole* console, unsigned int const* c)
+void consolehckConsoleInputPromptUnicodeN(consolehckConsole* console, unsigned int const* c, unsigned int const num)
 {
   consolehckStringBufferClear(console->input.prompt);
-  consolehckStringBufferPushUnicodeString(console->input.prompt, c);
+  consolehckStringBufferPushUnicodeStringN(console->input.prompt, c, num);
+  console->dirty |= CONSOLEHCK_DIRTY_PROMPT;
+}
+
+void consolehckConsoleInputHistoryPrevious(consolehckConsole* console)
+{
+  consolehckInputLine* const line = &console->input;
+  consolehckConsoleInputSearchEnd(console);
+  if(line->historyPosition == 0)
+    return;
+
+  // Keep the line being edited so stepping past the newest entry brings it back
+  if(line->historyPosition == consolehckHistoryCount(line->history))
+  {
+    consolehckGapBuffer* const input = line->input;
+    consolehckStringBufferClear(line->draft);
+    consolehckStringBufferPushUnicodeStringN(line->draft, consolehckGapBufferText(input), consolehckGapBufferLength(input));
+  }
+
+  line->historyPosition -= 1;
+  consolehckConsoleInputShowHistory(console, line->historyPosition);
+}
+
+void consolehckConsoleInputHistoryNext(consolehckConsole* console)
+{
+  consolehckInputLine* const line = &console->input;
+  consolehckConsoleInputSearchEnd(console);
+  if(line->historyPosition >= consolehckHistoryCount(line->history))
+    return;
+
+  line->historyPosition += 1;
+  if(line->historyPosition == consolehckHistoryCount(line->history))
+  {
+    consolehckGapBufferClear(line->input);
+    consolehckGapBufferInsertUnicodeStringN(line->input, line->draft->data, line->draft->length);
+    console->dirty |= CONSOLEHCK_DIRTY_INPUT;
+  }
+  else
+  {
+    consolehckConsoleInputShowHistory(console, line->historyPosition);
+  }
+}
+
+void consolehckConsoleInputHistoryLimit(consolehckConsole* console, unsigned int const maxEntries)
+{
+  consolehckConsoleInputSearchEnd(console);
+  consolehckHistoryLimit(console->input.history, maxEntries);
+  console->input.historyPosition = consolehckHistoryCount(console->input.history);
+}
+
+void consolehckConsoleInputSearch(consolehckConsole* console)
+{
+  // Starts a reverse search, or steps to the next older match if one is already going
+  consolehckInputLine* const line = &console->input;
+  if(!line->searching)
+  {
+    line->searching = 1;
+    consolehckStringBufferClear(line->searchQuery);
+    line->searchMatch = consolehckHistoryCount(line->history);
+    console->dirty |= CONSOLEHCK_DIRTY_PROMPT;
+    return;
+  }
+
+  consolehckConsoleInputSearchUpdate(console, line->searchMatch);
+}
+
+void consolehckConsoleInputSearchEnd(consolehckConsole* console)
+{
+  // Leaves the matched line in the input for editing
+  if(!console->input.searching)
+    return;
+
+  console->input.searching = 0;
+  console->dirty |= CONSOLEHCK_DIRTY_PROMPT;
 }
 
 void consolehckConsoleInputEnter(consolehckConsole* console)
 {
+  consolehckInputLine* const line = &console->input;
+  consolehckConsoleInputSearchEnd(console);
+
+  // Callbacks get the whole line, which leaves the cursor at its end
+  console->dirty |= CONSOLEHCK_DIRTY_INPUT;
+
+  unsigned int const* const text = consolehckGapBufferText(line->input);
+  unsigned int const length = consolehckGapBufferLength(line->input);
+  int const utf8Length = utf8EncodedStringLengthN(text, length);
+  char* const utf8Text = calloc(utf8Length + 1, 1);
+  utf8EncodeStringN(text, length, utf8Text);
+  consolehckHistoryPush(line->history, utf8Text, utf8Length);
+  line->historyPosition = consolehckHistoryCount(line->history);
+  free(utf8Text);
+
+  // Tokenize once and hand the tokens to the command named by the first one
+  unsigned int const argc = consolehckConsoleTokenize(console, text, length);
+
+  if(argc > 0)
+  {
+    consolehckCommand const* const command = consolehckCommandsFind(console->commands, text + console->tokens[0].start, console->tokens[0].length);
+    if(command != NULL && command->callback(console, text, argc, console->tokens) == CONSOLEHCK_STOP)
+      return;
+  }
+
   unsigned int i;
   for(i = 0; i < console->numInputCallbacks; ++i)
   {
-    if((console->inputCallbacks[i])(console, console->input.input->data) == CONSOLEHCK_STOP)
+    if((console->inputCallbacks[i])(console, consolehckGapBufferText(console->input.input)) == CONSOLEHCK_STOP)
       break;
   }
 }
 
 void consolehckConsoleInputCallbackRegister(consolehckConsole* console, consolehckInputCallback callback)
 {
-  consolehckInputCallback* old = console->inputCallbacks;
-  console->inputCallbacks = calloc(console->numInputCallbacks + 1, sizeof(consolehckInputCallback));
-  if(old != NULL)
+  if(console->numInputCallbacks == console->inputCallbacksSize)
   {
-    memcpy(console->inputCallbacks, old, console->numInputCallbacks * sizeof(consolehckInputCallback));
+    console->inputCallbacksSize = console->inputCallbacksSize > 0 ? console->inputCallbacksSize * 2 : 4;
+    console->inputCallbacks = realloc(console->inputCallbacks, console->inputCallbacksSize * sizeof(consolehckInputCallback));
   }
   console->inputCallbacks[console->numInputCallbacks] = callback;
   console->numInputCallbacks += 1;
 }
 
+void consolehckConsoleCommandRegister(consolehckConsole* console, char const* name, consolehckCommandCallback callback)
+{
+  consolehckCommandsRegister(console->commands, name, callback);
+}
+
+void consolehckConsoleCommandUnregister(consolehckConsole* console, char const* name)
+{
+  consolehckCommandsUnregister(console->commands, name);
+}
+
+void consolehckConsoleCommandCompleter(consolehckConsole* console, char const* name, consolehckArgumentCompleter completer)
+{
+  consolehckCommandsCompleter(console->commands, name, completer);
+}
+
+void consolehckConsoleInputComplete(consolehckConsole* console)
+{
+  consolehckConsoleInputSearchEnd(console);
+
+  // The text before the cursor is contiguous at the start of the gap buffer
+  consolehckGapBuffer* const input = console->input.input;
+  unsigned int const cursor = consolehckGapBufferCursor(input);
+  unsigned int const* const text = input->data;
+
+  // The token ending at the cursor is completed, a cursor after whitespace starts an empty one
+  unsigned int argc = consolehckConsoleTokenize(console, text, cursor);
+  if(argc == 0 || console->tokens[argc - 1].start + console->tokens[argc - 1].length < cursor)
+  {
+    console->tokens[argc].start = cursor;
+    console->tokens[argc].length = 0;
+    argc += 1;
+  }
+
+  consolehckToken const token = console->tokens[argc - 1];
+  consolehckCompletions* const completions = console->completions;
+  consolehckCompletionsReset(completions, text + token.start, token.length);
+  if(argc == 1)
+  {
+    consolehckTrieComplete(console->commands->names, completions);
+  }
+  else
+  {
+    consolehckCommand const* const command = consolehckCommandsFind(console->commands, text + console->tokens[0].start, console->tokens[0].length);
+    if(command != NULL && command->completer != NULL)
+    {
+      command->completer(console, text, argc, console->tokens, completions);
+    }
+  }
+
+  if(completions->count == 0)
+    return;
+
+  // Expand as far as the candidates agree, a single candidate is finished off with a space
+  unsigned int const* const candidates = completions->text->data;
+  if(completions->common > token.length || completions->count == 1)
+  {
+    consolehckGapBufferInsertUnicodeStringN(input, candidates + token.length, completions->common - token.length);
+    if(completions->count == 1)
+    {
+      consolehckGapBufferInsertStringN(input, " ", 1);
+    }
+    console->dirty |= CONSOLEHCK_DIRTY_INPUT;
+    return;
+  }
+
+  unsigned int i;
+  unsigned int start = 0;
+  for(i = 0; i < completions->count; ++i)
+  {
+    unsigned int const length = unicodeStringLength(candidates + start);
+    consolehckConsoleOutputUnicodeStringN(console, candidates + start, length);
+    consolehckConsoleOutputChar(console, i + 1 < completions->count ? ' ' : '\n');
+    start += length + 1;
+  }
+}
+
 consolehckStringBuffer* consolehckStringBufferNew(unsigned int const initialSize)
 {
   consolehckStringBuffer* const buffer = calloc(1, sizeof(consolehckStringBuffer));
@@ -294,20 +1129,34 @@ void consolehckStringBufferClear(consolehckStringBuffer *buffer)
   buffer->length = 0;
 }
 
+void consolehckStringBufferTrim(consolehckStringBuffer* buffer)
+{
+  // Down to the contents and the terminating zero
+  if(buffer->bufferSize > buffer->length + 1)
+  {
+    consolehckStringBufferResize(buffer, buffer->length + 1);
+  }
+}
+
+void consolehckStringBufferMemory(consolehckStringBuffer const* buffer, consolehckMemory* memory)
+{
+  memory->used += sizeof(consolehckStringBuffer) + (buffer->length + 1) * sizeof(unsigned int);
+  memory->reserved += sizeof(consolehckStringBuffer) + buffer->bufferSize * sizeof(unsigned int);
+}
+
 void consolehckStringBufferPushChar(consolehckStringBuffer* buffer, char const c)
 {
   unsigned int codepoint;
   unsigned int state = 0;
-  assert(!utf8Decode(&state, &codepoint, c));
+  unsigned int const result = utf8Decode(&state, &codepoint, (unsigned char) c);
+  assert(result == 0);
+  (void) result;
   consolehckStringBufferPushUnicodeChar(buffer, codepoint);
 }
 
 void consolehckStringBufferPushUnicodeChar(consolehckStringBuffer* buffer, unsigned int const c)
 {
-  if(buffer->bufferSize <= buffer->length + 1)
-  {
-    consolehckStringBufferResize(buffer, buffer->bufferSize * 2);
-  }
+  consolehckStringBufferReserve(buffer, 1);
 
   buffer->data[buffer->length] = c;
   buffer->length += 1;
@@ -316,33 +1165,45 @@ void consolehckStringBufferPushUnicodeChar(consolehckStringBuffer* buffer, unsig
 
 void consolehckStringBufferPushString(consolehckStringBuffer* buffer, char const* c)
 {
-  int numCodepoints;
-  utf8CountCodePoints((unsigned char*)c, &numCodepoints);
-  unsigned int* codepoints = calloc(numCodepoints + 1, sizeof(unsigned int));
-  utf8DecodeString(c, codepoints);
-  codepoints[numCodepoints] = 0;
-  consolehckStringBufferPushUnicodeString(buffer, codepoints);
-  free(codepoints);
+  consolehckStringBufferPushStringN(buffer, c, strlen(c));
+}
+
+void consolehckStringBufferPushStringN(consolehckStringBuffer* buffer, char const* c, unsigned int const length)
+{
+  // Every byte decodes to at most one codepoint, so reserve by byte length and decode in place
+  consolehckStringBufferReserve(buffer, length);
+  buffer->length += utf8DecodeStringN(c, length, buffer->data + buffer->length);
+  buffer->data[buffer->length] = 0;
 }
 
 void consolehckStringBufferPushUnicodeString(consolehckStringBuffer* buffer, unsigned int const* c)
 {
-  int const num = unicodeStringLength(c);
-  if(buffer->bufferSize <= buffer->length + num)
-  {
-    unsigned int newSize = buffer->bufferSize;
-    while(newSize <= buffer->length + num)
-    {
-      newSize *= 2;
-    }
-    consolehckStringBufferResize(buffer, newSize);
-  }
+  consolehckStringBufferPushUnicodeStringN(buffer, c, unicodeStringLength(c));
+}
+
+void consolehckStringBufferPushUnicodeStringN(consolehckStringBuffer* buffer, unsigned int const* c, unsigned int const num)
+{
+  consolehckStringBufferReserve(buffer, num);
 
   memcpy(buffer->data + buffer->length, c, num * sizeof(unsigned int));
   buffer->length += num;
   buffer->data[buffer->length] = 0;
 }
 
+static void consolehckStringBufferReserve(consolehckStringBuffer* buffer, unsigned int const num)
+{
+  // Grow at most once to fit num more codepoints and the terminating zero
+  if(buffer->bufferSize > buffer->length + num)
+    return;
+
+  unsigned int newSize = buffer->bufferSize > 0 ? buffer->bufferSize : 1;
+  while(newSize <= buffer->length + num)
+  {
+    newSize *= 2;
+  }
+  consolehckStringBufferResize(buffer, newSize);
+}
+
 char consolehckStringBufferPopChar(consolehckStringBuffer* buffer)
 {
   unsigned int const codepoint = consolehckStringBufferPopUnicodeChar(buffer);
@@ -368,111 +1229,3 @@ unsigned int consolehckStringBufferPopUnicodeChar(consolehckStringBuffer* buffer
 
   return result;
 }
-
-void consolehckTextRenderUnicode(glhckText* textObject, glhckRect const* rect, int const offset, consolehckWrapMode wrapMode, unsigned int fontId, unsigned int fontSize, unsigned int const* const str)
-{
-  /* Work through the character data backwards and find newline-separated lines.
-   * For each line determine if wrapping is required. If no wrapping is required, render the line.
-   * If wrapping is required, find the last non-rendered wrap-line within the line and render them
-   * until the entire line is rendered.
-   */
-
-  int const lineOffset = offset % (int) fontSize;
-  int const firstVisibleLine = offset / (int) fontSize + 1;
-  unsigned int const numVisibleLines = rect->h / fontSize + 1;
-  unsigned int lineStart = unicodeStringLength(str);
-  unsigned int lineLength = 0;
-  int currentLine = 1;
-
-  while(numVisibleLines > currentLine && lineStart > 0)
-  {
-    lineLength = 0;
-    --lineStart;
-
-    // Find the next line of text in raw char data
-    while(lineStart > 0 && str[lineStart - 1] != '\n')
-    {
-      --lineStart;
-      ++lineLength;
-    }
-
-    // Skip rendering empty lines
-    if(lineLength == 0)
-    {
-      ++currentLine;
-      continue;
-    }
-
-    // Copy line to a null-terminated unicode array for processing
-    unsigned int* const line = calloc(lineLength + 1, sizeof(unsigned int));
-    memcpy(line, str + lineStart, lineLength * sizeof(unsigned int));
-    line[lineLength] = 0;
-    int utf8LineLength = utf8EncodedStringLength(line);
-    char* const utf8Line = calloc(utf8LineLength + 1, 1);
-    utf8EncodeString(line, utf8Line);
-    utf8Line[utf8LineLength] = 0;
-
-    kmVec2 minv, maxv;
-    glhckTextGetMinMax(textObject, fontId, fontSize, utf8Line, &minv, &maxv);
-
-    if(maxv.x <= rect->w || wrapMode == CONSOLEHCK_NO_WRAP)
-    {
-      // No wrapping required
-      float lineY = rect->h - (currentLine - firstVisibleLine + 1) * fontSize + lineOffset;
-
-      if(currentLine >= firstVisibleLine)
-      {
-        glhckTextStash(textObject, fontId, fontSize, rect->x, rect->y + lineY, utf8Line, 0);
-      }
-      ++currentLine;
-    }
-    else
-    {
-      // Until all wrap-lines rendered
-      char* const utf8WrapLine = calloc(utf8LineLength + 1, 1);
-      while(numVisibleLines > currentLine && lineLength > 0)
-      {
-        // Find the last non-rendered wrap-line
-        unsigned int linePosition;
-        unsigned int wrapLineLength = 0;
-        unsigned int utf8WrapLineLength = 0;
-        unsigned int utf8WrapLineStart = 0;
-
-        for(linePosition = 0; linePosition < lineLength; ++linePosition)
-        {
-          int charLength = utf8EncodedLength(line[linePosition]);
-          memcpy(utf8WrapLine + utf8WrapLineLength, utf8Line + utf8WrapLineStart + utf8WrapLineLength, charLength);
-          utf8WrapLineLength += charLength;
-          utf8WrapLine[utf8WrapLineLength] = '\0';
-          ++wrapLineLength;
-
-          glhckTextGetMinMax(textObject, fontId, fontSize, utf8WrapLine, &minv, &maxv);
-
-          if(maxv.x > rect->w)
-          {
-            memset(utf8WrapLine, 0, utf8WrapLineLength);
-            utf8WrapLineStart += utf8WrapLineLength - charLength;
-            utf8WrapLineLength = 0;
-            wrapLineLength = 0;
-            --linePosition;
-          }
-        }
-
-        // Render wrap-line
-        float const lineY = rect->h - (currentLine - firstVisibleLine + 1) * fontSize + lineOffset;
-        if(currentLine >= firstVisibleLine)
-        {
-          glhckTextStash(textObject, fontId, fontSize, rect->x, rect->y + lineY, utf8WrapLine, NULL);
-        }
-        ++currentLine;
-        lineLength -= wrapLineLength;
-      }
-      free(utf8WrapLine);
-    }
-
-    free(line);
-    free(utf8Line);
-  }
-}
-
-
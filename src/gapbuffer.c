@@ -0,0 +1,193 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+static void consolehckGapBufferReserve(consolehckGapBuffer* buffer, unsigned int const num);
+static void consolehckGapBufferResize(consolehckGapBuffer* buffer, unsigned int const newSize);
+static int consolehckGapBufferIsSpace(unsigned int const c);
+
+consolehckGapBuffer* consolehckGapBufferNew(unsigned int const initialSize)
+{
+  consolehckGapBuffer* const buffer = calloc(1, sizeof(consolehckGapBuffer));
+  buffer->bufferSize = initialSize > 0 ? initialSize : 1;
+  buffer->data = calloc(buffer->bufferSize, sizeof(unsigned int));
+  buffer->gapStart = 0;
+  buffer->gapEnd = buffer->bufferSize;
+
+  return buffer;
+}
+
+void consolehckGapBufferFree(consolehckGapBuffer* buffer)
+{
+  free(buffer->data);
+  buffer->data = NULL;
+  buffer->bufferSize = 0;
+  buffer->gapStart = 0;
+  buffer->gapEnd = 0;
+  free(buffer);
+}
+
+void consolehckGapBufferClear(consolehckGapBuffer* buffer)
+{
+  buffer->gapStart = 0;
+  buffer->gapEnd = buffer->bufferSize;
+}
+
+unsigned int consolehckGapBufferLength(consolehckGapBuffer const* buffer)
+{
+  return buffer->bufferSize - (buffer->gapEnd - buffer->gapStart);
+}
+
+unsigned int consolehckGapBufferCursor(consolehckGapBuffer const* buffer)
+{
+  return buffer->gapStart;
+}
+
+unsigned int consolehckGapBufferGet(consolehckGapBuffer const* buffer, unsigned int const index)
+{
+  if(index < buffer->gapStart)
+    return buffer->data[index];
+
+  unsigned int const physical = index + (buffer->gapEnd - buffer->gapStart);
+  return physical < buffer->bufferSize ? buffer->data[physical] : 0;
+}
+
+unsigned int const* consolehckGapBufferText(consolehckGapBuffer* buffer)
+{
+  // Close the gap by moving the cursor to the end, the text is then contiguous and zero-terminated
+  consolehckGapBufferMove(buffer, consolehckGapBufferLength(buffer));
+  buffer->data[buffer->gapStart] = 0;
+  return buffer->data;
+}
+
+void consolehckGapBufferMove(consolehckGapBuffer* buffer, unsigned int const position)
+{
+  // Moving the cursor shifts only the codepoints between the old and the new position across the gap
+  unsigned int const length = consolehckGapBufferLength(buffer);
+  unsigned int const target = position < length ? position : length;
+  unsigned int const gap = buffer->gapEnd - buffer->gapStart;
+
+  if(target < buffer->gapStart)
+  {
+    unsigned int const num = buffer->gapStart - target;
+    memmove(buffer->data + buffer->gapEnd - num, buffer->data + target, num * sizeof(unsigned int));
+  }
+  else if(target > buffer->gapStart)
+  {
+    unsigned int const num = target - buffer->gapStart;
+    memmove(buffer->data + buffer->gapStart, buffer->data + buffer->gapEnd, num * sizeof(unsigned int));
+  }
+
+  buffer->gapStart = target;
+  buffer->gapEnd = target + gap;
+}
+
+void consolehckGapBufferInsertUnicodeStringN(consolehckGapBuffer* buffer, unsigned int const* c, unsigned int const num)
+{
+  consolehckGapBufferReserve(buffer, num);
+  memcpy(buffer->data + buffer->gapStart, c, num * sizeof(unsigned int));
+  buffer->gapStart += num;
+}
+
+void consolehckGapBufferInsertStringN(consolehckGapBuffer* buffer, char const* c, unsigned int const length)
+{
+  // Every byte decodes to at most one codepoint, so reserve by byte length and decode into the gap
+  consolehckGapBufferReserve(buffer, length);
+  buffer->gapStart += utf8DecodeStringN(c, length, buffer->data + buffer->gapStart);
+}
+
+unsigned int consolehckGapBufferDeleteBackward(consolehckGapBuffer* buffer)
+{
+  if(buffer->gapStart == 0)
+    return 0;
+
+  buffer->gapStart -= 1;
+  return buffer->data[buffer->gapStart];
+}
+
+unsigned int consolehckGapBufferDeleteForward(consolehckGapBuffer* buffer)
+{
+  if(buffer->gapEnd == buffer->bufferSize)
+    return 0;
+
+  buffer->gapEnd += 1;
+  return buffer->data[buffer->gapEnd - 1];
+}
+
+unsigned int consolehckGapBufferWordLeft(consolehckGapBuffer const* buffer, unsigned int position)
+{
+  // Start of the word at or before position, skipping any whitespace in between
+  while(position > 0 && consolehckGapBufferIsSpace(consolehckGapBufferGet(buffer, position - 1)))
+    --position;
+  while(position > 0 && !consolehckGapBufferIsSpace(consolehckGapBufferGet(buffer, position - 1)))
+    --position;
+
+  return position;
+}
+
+unsigned int consolehckGapBufferWordRight(consolehckGapBuffer const* buffer, unsigned int position)
+{
+  // End of the word at or after position, skipping any whitespace in between
+  unsigned int const length = consolehckGapBufferLength(buffer);
+  while(position < length && consolehckGapBufferIsSpace(consolehckGapBufferGet(buffer, position)))
+    ++position;
+  while(position < length && !consolehckGapBufferIsSpace(consolehckGapBufferGet(buffer, position)))
+    ++position;
+
+  return position;
+}
+
+void consolehckGapBufferMemory(consolehckGapBuffer const* buffer, consolehckMemory* memory)
+{
+  memory->used += sizeof(consolehckGapBuffer) + consolehckGapBufferLength(buffer) * sizeof(unsigned int);
+  memory->reserved += sizeof(consolehckGapBuffer) + buffer->bufferSize * sizeof(unsigned int);
+}
+
+void consolehckGapBufferTrim(consolehckGapBuffer* buffer)
+{
+  // Down to the text and the free slot consolehckGapBufferText terminates it in
+  unsigned int const length = consolehckGapBufferLength(buffer);
+  if(buffer->bufferSize > length + 1)
+  {
+    consolehckGapBufferResize(buffer, length + 1);
+  }
+}
+
+static void consolehckGapBufferReserve(consolehckGapBuffer* buffer, unsigned int const num)
+{
+  // Keep at least one free slot past the text so consolehckGapBufferText can terminate it
+  unsigned int const gap = buffer->gapEnd - buffer->gapStart;
+  if(gap > num)
+    return;
+
+  unsigned int const length = buffer->bufferSize - gap;
+  unsigned int newSize = buffer->bufferSize;
+  while(newSize - length <= num)
+  {
+    newSize *= 2;
+  }
+
+  consolehckGapBufferResize(buffer, newSize);
+}
+
+static void consolehckGapBufferResize(consolehckGapBuffer* buffer, unsigned int const newSize)
+{
+  // The gap takes up the change in size, the cursor stays where it is
+  unsigned int* const newData = calloc(newSize, sizeof(unsigned int));
+  unsigned int const after = buffer->bufferSize - buffer->gapEnd;
+  memcpy(newData, buffer->data, buffer->gapStart * sizeof(unsigned int));
+  memcpy(newData + newSize - after, buffer->data + buffer->gapEnd, after * sizeof(unsigned int));
+
+  free(buffer->data);
+  buffer->data = newData;
+  buffer->gapEnd = newSize - after;
+  buffer->bufferSize = newSize;
+}
+
+static int consolehckGapBufferIsSpace(unsigned int const c)
+{
+  return c == ' ' || c == '\t';
+}
@@ -0,0 +1,85 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <memory.h>
+
+// Glyph measured after every probed codepoint to get its advance
+static char const GLHCK_REFERENCE[] = "|";
+
+static float consolehckGlhckAdvance(void* userData, unsigned int const fontId, unsigned int const fontSize, unsigned int const codepoint);
+
+consolehckFontMetrics consolehckGlhckFontMetrics(glhckText* text)
+{
+  consolehckFontMetrics const metrics = {consolehckGlhckAdvance, text};
+  return metrics;
+}
+
+void consolehckGlhckDraw(glhckText* text, consolehckLayout const* layout)
+{
+  // One render per color, the text object is left in the color of the last batch
+  unsigned int i;
+  for(i = 0; i < layout->numBatches; ++i)
+  {
+    consolehckGlyphBatch const* const batch = &layout->batches[i];
+    if(batch->numRuns == 0)
+      continue;
+
+    unsigned long long begin = consolehckStatsBegin(layout->stats);
+    glhckTextColorb(text, batch->color.r, batch->color.g, batch->color.b, batch->color.a);
+
+    unsigned int j;
+    for(j = 0; j < batch->numRuns; ++j)
+    {
+      consolehckGlyphRun const* const run = &batch->runs[j];
+      glhckTextStash(text, layout->fontId, layout->fontSize, run->x, run->y, batch->text + run->start, NULL);
+    }
+
+    if(layout->stats != NULL)
+    {
+      // Counted run by run, so invalid UTF-8 only cuts the count of its own run short
+      for(j = 0; j < batch->numRuns; ++j)
+      {
+        int glyphs;
+        utf8CountCodePointsN((unsigned char const*) batch->text + batch->runs[j].start, batch->runs[j].length, &glyphs);
+        layout->stats->glyphsStashed += glyphs;
+      }
+      consolehckStatsEnd(layout->stats, CONSOLEHCK_PHASE_STASH, begin);
+      begin = consolehckStatsBegin(layout->stats);
+    }
+
+    glhckTextRender(text);
+    glhckTextClear(text);
+    consolehckStatsEnd(layout->stats, CONSOLEHCK_PHASE_RENDER, begin);
+  }
+}
+
+void consolehckTextRenderUnicode(glhckText* textObject, consolehckGlyphCache* glyphs, glhckRect const* rect, int const offset, consolehckWrapMode wrapMode, unsigned int fontId, unsigned int fontSize, consolehckScrollback* text, consolehckTextColors const* colors)
+{
+  // Counted wherever the glyph cache is
+  consolehckLayout* const layout = consolehckLayoutNew();
+  layout->stats = glyphs->stats;
+  consolehckLayoutReset(layout, fontId, fontSize);
+  consolehckLayoutOutput(layout, glyphs, rect, offset, wrapMode, text, colors);
+  consolehckGlhckDraw(textObject, layout);
+  consolehckLayoutFree(layout);
+}
+
+static float consolehckGlhckAdvance(void* userData, unsigned int const fontId, unsigned int const fontSize, unsigned int const codepoint)
+{
+  /* Measure the codepoint followed by a reference glyph and subtract the reference alone.
+   * The difference is the pen advance of the codepoint, regardless of whether the measured
+   * extent is the pen position or the bounding box of the last glyph.
+   */
+  glhckText* const text = userData;
+  kmVec2 minv, maxv;
+
+  glhckTextGetMinMax(text, fontId, fontSize, GLHCK_REFERENCE, &minv, &maxv);
+  float const reference = maxv.x;
+
+  char probe[4 + sizeof(GLHCK_REFERENCE)];
+  int const length = utf8Encode(codepoint, probe, 4);
+  memcpy(probe + length, GLHCK_REFERENCE, sizeof(GLHCK_REFERENCE));
+
+  glhckTextGetMinMax(text, fontId, fontSize, probe, &minv, &maxv);
+  return maxv.x - reference;
+}
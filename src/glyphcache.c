@@ -0,0 +1,355 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <stdlib.h>
+#include <memory.h>
+
+/* Fixed-width fonts are recognized by a few glyphs of very different shapes having the same advance.
+ * Their glyphs then take one cell each, or two or none for the codepoints in the ranges below, and
+ * nothing but the probes is ever measured.
+ */
+
+// Glyphs compared to tell a fixed-width font from a proportional one
+static char const GLYPH_CACHE_PROBES[] = "iMW.0 ";
+
+// Inclusive codepoint ranges of wide East Asian characters and of zero width combining characters, in order
+static unsigned int const GLYPH_CACHE_WIDE[][2] = {
+  {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x2E80, 0x303E}, {0x3041, 0x33FF}, {0x3400, 0x4DBF},
+  {0x4E00, 0x9FFF}, {0xA000, 0xA4CF}, {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19},
+  {0xFE30, 0xFE6F}, {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x1F300, 0x1F64F}, {0x1F900, 0x1F9FF},
+  {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD}
+};
+static unsigned int const GLYPH_CACHE_ZERO_WIDTH[][2] = {
+  {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0E31, 0x0E31},
+  {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F}, {0x20D0, 0x20FF},
+  {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF}
+};
+
+static float consolehckGlyphCacheMeasure(consolehckGlyphCache* cache, unsigned int const codepoint);
+static void consolehckGlyphCacheProbe(consolehckGlyphCache* cache);
+static unsigned int consolehckGlyphCacheWrapColumns(consolehckGlyphCache* cache, char const* text, unsigned int const length, float const width, unsigned int* rowStarts, unsigned int const maxRows);
+static unsigned int consolehckGlyphStringColumns(char const* text, unsigned int const length);
+static int consolehckGlyphRangesContain(unsigned int const (* ranges)[2], unsigned int const num, unsigned int const codepoint);
+static void consolehckGlyphCacheRehash(consolehckGlyphCache* cache, unsigned int const newSize);
+
+consolehckGlyphCache* consolehckGlyphCacheNew(consolehckFontMetrics const* metrics)
+{
+  consolehckGlyphCache* const cache = calloc(1, sizeof(consolehckGlyphCache));
+  cache->metrics = *metrics;
+  cache->stats = NULL;
+  cache->fontId = 0;
+  cache->fontSize = 0;
+  cache->spacing = CONSOLEHCK_SPACING_DETECT;
+  cache->cellWidth = 0.0f;
+  cache->size = 64;
+  cache->codepoints = calloc(cache->size, sizeof(unsigned int));
+  cache->advances = calloc(cache->size, sizeof(float));
+  consolehckGlyphCacheClear(cache);
+
+  return cache;
+}
+
+void consolehckGlyphCacheFree(consolehckGlyphCache* cache)
+{
+  free(cache->codepoints);
+  free(cache->advances);
+  free(cache);
+}
+
+void consolehckGlyphCacheClear(consolehckGlyphCache* cache)
+{
+  unsigned int i;
+  for(i = 0; i < CONSOLEHCK_GLYPH_CACHE_DIRECT; ++i)
+  {
+    cache->direct[i] = -1.0f;
+  }
+
+  memset(cache->codepoints, 0, cache->size * sizeof(unsigned int));
+  cache->count = 0;
+}
+
+void consolehckGlyphCacheFont(consolehckGlyphCache* cache, unsigned int const fontId, unsigned int const fontSize)
+{
+  if(cache->fontId == fontId && cache->fontSize == fontSize)
+    return;
+
+  cache->fontId = fontId;
+  cache->fontSize = fontSize;
+  consolehckGlyphCacheClear(cache);
+  consolehckGlyphCacheProbe(cache);
+}
+
+void consolehckGlyphCacheSpacing(consolehckGlyphCache* cache, consolehckFontSpacing const spacing)
+{
+  cache->spacing = spacing;
+  consolehckGlyphCacheClear(cache);
+  consolehckGlyphCacheProbe(cache);
+}
+
+unsigned int consolehckGlyphColumns(unsigned int const codepoint)
+{
+  if(codepoint < GLYPH_CACHE_ZERO_WIDTH[0][0])
+    return 1;
+
+  if(consolehckGlyphRangesContain(GLYPH_CACHE_ZERO_WIDTH, sizeof(GLYPH_CACHE_ZERO_WIDTH) / sizeof(GLYPH_CACHE_ZERO_WIDTH[0]), codepoint))
+    return 0;
+
+  if(consolehckGlyphRangesContain(GLYPH_CACHE_WIDE, sizeof(GLYPH_CACHE_WIDE) / sizeof(GLYPH_CACHE_WIDE[0]), codepoint))
+    return 2;
+
+  return 1;
+}
+
+float consolehckGlyphCacheAdvance(consolehckGlyphCache* cache, unsigned int const codepoint)
+{
+  if(cache->cellWidth > 0.0f)
+    return cache->cellWidth * consolehckGlyphColumns(codepoint);
+
+  if(codepoint < CONSOLEHCK_GLYPH_CACHE_DIRECT)
+  {
+    if(cache->direct[codepoint] < 0.0f)
+    {
+      cache->direct[codepoint] = consolehckGlyphCacheMeasure(cache, codepoint);
+    }
+    return cache->direct[codepoint];
+  }
+
+  // Open addressing with linear probing, 0 marks an empty slot
+  unsigned int const mask = cache->size - 1;
+  unsigned int slot = (codepoint * 2654435761u) & mask;
+  while(cache->codepoints[slot] != 0)
+  {
+    if(cache->codepoints[slot] == codepoint)
+      return cache->advances[slot];
+    slot = (slot + 1) & mask;
+  }
+
+  float const advance = consolehckGlyphCacheMeasure(cache, codepoint);
+  cache->codepoints[slot] = codepoint;
+  cache->advances[slot] = advance;
+  cache->count += 1;
+
+  if(cache->count * 2 > cache->size)
+  {
+    consolehckGlyphCacheRehash(cache, cache->size * 2);
+  }
+
+  return advance;
+}
+
+float consolehckGlyphCacheWidth(consolehckGlyphCache* cache, unsigned int const* codepoints, unsigned int const num)
+{
+  float width = 0.0f;
+  unsigned int i;
+  for(i = 0; i < num; ++i)
+  {
+    width += consolehckGlyphCacheAdvance(cache, codepoints[i]);
+  }
+
+  return width;
+}
+
+float consolehckGlyphCacheStringWidth(consolehckGlyphCache* cache, char const* text, unsigned int const length)
+{
+  // Walks the UTF-8 text the same way consolehckGlyphCacheWrap does
+  if(cache->cellWidth > 0.0f)
+    return consolehckGlyphStringColumns(text, length) * cache->cellWidth;
+
+  float width = 0.0f;
+  unsigned int i = 0;
+  while(i < length)
+  {
+    int const charLength = text[i] != 0 ? utf8GetValidatedCharLength(text + i) : 1;
+    unsigned int const codepoint = charLength > 1 || (unsigned char) text[i] < 0x80 ? utf8GetChar(text + i) : UTF8_REPLACEMENT_CHAR;
+    width += consolehckGlyphCacheAdvance(cache, codepoint);
+    i += charLength;
+  }
+
+  return width;
+}
+
+unsigned int consolehckGlyphCacheWrap(consolehckGlyphCache* cache, char const* text, unsigned int const length, float const width, unsigned int* rowStarts, unsigned int const maxRows)
+{
+  // Single pass: start a new row before the first character that would overflow the current one.
+  // Every row holds at least one character so glyphs wider than the area can't stall the layout.
+  // Row starts are byte offsets, text must be followed by a zero byte so a truncated sequence can't read past it.
+  if(cache->cellWidth > 0.0f)
+    return consolehckGlyphCacheWrapColumns(cache, text, length, width, rowStarts, maxRows);
+
+  unsigned int numRows = 1;
+  float x = 0.0f;
+  unsigned int i = 0;
+
+  if(maxRows > 0)
+  {
+    rowStarts[0] = 0;
+  }
+
+  while(i < length)
+  {
+    int const charLength = text[i] != 0 ? utf8GetValidatedCharLength(text + i) : 1;
+    unsigned int const codepoint = charLength > 1 || (unsigned char) text[i] < 0x80 ? utf8GetChar(text + i) : UTF8_REPLACEMENT_CHAR;
+    float const advance = consolehckGlyphCacheAdvance(cache, codepoint);
+    if(x + advance > width && x > 0.0f)
+    {
+      if(numRows < maxRows)
+      {
+        rowStarts[numRows] = i;
+      }
+      ++numRows;
+      x = 0.0f;
+    }
+    x += advance;
+    i += charLength;
+  }
+
+  return numRows;
+}
+
+void consolehckGlyphCacheMemory(consolehckGlyphCache const* cache, consolehckMemory* memory)
+{
+  memory->used += sizeof(consolehckGlyphCache) + cache->count * (sizeof(unsigned int) + sizeof(float));
+  memory->reserved += sizeof(consolehckGlyphCache) + cache->size * (sizeof(unsigned int) + sizeof(float));
+}
+
+static float consolehckGlyphCacheMeasure(consolehckGlyphCache* cache, unsigned int const codepoint)
+{
+  unsigned long long const begin = consolehckStatsBegin(cache->stats);
+  float const advance = cache->metrics.advance(cache->metrics.userData, cache->fontId, cache->fontSize, codepoint);
+  consolehckStatsEnd(cache->stats, CONSOLEHCK_PHASE_MEASURE, begin);
+
+  if(cache->stats != NULL)
+  {
+    cache->stats->measureCalls += 1;
+  }
+
+  return advance > 0.0f ? advance : 0.0f;
+}
+
+static void consolehckGlyphCacheProbe(consolehckGlyphCache* cache)
+{
+  // A font told to be fixed-width is only measured for its cell width
+  cache->cellWidth = 0.0f;
+  if(cache->spacing == CONSOLEHCK_SPACING_PROPORTIONAL || cache->fontSize == 0)
+    return;
+
+  float const cellWidth = consolehckGlyphCacheMeasure(cache, GLYPH_CACHE_PROBES[0]);
+  unsigned int i;
+  for(i = 1; cache->spacing == CONSOLEHCK_SPACING_DETECT && i < sizeof(GLYPH_CACHE_PROBES) - 1; ++i)
+  {
+    float const advance = consolehckGlyphCacheMeasure(cache, GLYPH_CACHE_PROBES[i]);
+    if(advance - cellWidth > 0.01f || cellWidth - advance > 0.01f)
+      return;
+  }
+
+  cache->cellWidth = cellWidth;
+}
+
+static unsigned int consolehckGlyphCacheWrapColumns(consolehckGlyphCache* cache, char const* text, unsigned int const length, float const width, unsigned int* rowStarts, unsigned int const maxRows)
+{
+  // consolehckGlyphCacheWrap for a fixed-width font, counting whole columns against the columns that fit
+  unsigned int const maxColumns = (unsigned int) (width / cache->cellWidth + 0.001f);
+  unsigned int numRows = 1;
+  unsigned int column = 0;
+  unsigned int i = 0;
+
+  if(maxRows > 0)
+  {
+    rowStarts[0] = 0;
+  }
+
+  while(i < length)
+  {
+    int charLength = 1;
+    unsigned int columns = 1;
+    if((unsigned char) text[i] >= 0x80)
+    {
+      charLength = utf8GetValidatedCharLength(text + i);
+      columns = charLength > 1 ? consolehckGlyphColumns(utf8GetChar(text + i)) : 1;
+    }
+
+    if(column + columns > maxColumns && column > 0)
+    {
+      if(numRows < maxRows)
+      {
+        rowStarts[numRows] = i;
+      }
+      ++numRows;
+      column = 0;
+    }
+    column += columns;
+    i += charLength;
+  }
+
+  return numRows;
+}
+
+static unsigned int consolehckGlyphStringColumns(char const* text, unsigned int const length)
+{
+  // ASCII is one column a byte and needs no decoding
+  unsigned int columns = 0;
+  unsigned int i = 0;
+  while(i < length)
+  {
+    if((unsigned char) text[i] < 0x80)
+    {
+      ++columns;
+      ++i;
+      continue;
+    }
+
+    int const charLength = utf8GetValidatedCharLength(text + i);
+    columns += charLength > 1 ? consolehckGlyphColumns(utf8GetChar(text + i)) : 1;
+    i += charLength;
+  }
+
+  return columns;
+}
+
+static int consolehckGlyphRangesContain(unsigned int const (* ranges)[2], unsigned int const num, unsigned int const codepoint)
+{
+  // Binary search for the last range starting at or before codepoint
+  unsigned int low = 0;
+  unsigned int high = num;
+  while(low < high)
+  {
+    unsigned int const middle = low + (high - low) / 2;
+    if(ranges[middle][0] <= codepoint)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  return low > 0 && codepoint <= ranges[low - 1][1];
+}
+
+static void consolehckGlyphCacheRehash(consolehckGlyphCache* cache, unsigned int const newSize)
+{
+  unsigned int* const oldCodepoints = cache->codepoints;
+  float* const oldAdvances = cache->advances;
+  unsigned int const oldSize = cache->size;
+
+  cache->size = newSize;
+  cache->codepoints = calloc(newSize, sizeof(unsigned int));
+  cache->advances = calloc(newSize, sizeof(float));
+  consolehckStatsAllocated(cache->stats, newSize * (sizeof(unsigned int) + sizeof(float)));
+
+  unsigned int const mask = newSize - 1;
+  unsigned int i;
+  for(i = 0; i < oldSize; ++i)
+  {
+    if(oldCodepoints[i] == 0)
+      continue;
+
+    unsigned int slot = (oldCodepoints[i] * 2654435761u) & mask;
+    while(cache->codepoints[slot] != 0)
+    {
+      slot = (slot + 1) & mask;
+    }
+    cache->codepoints[slot] = oldCodepoints[i];
+    cache->advances[slot] = oldAdvances[i];
+  }
+
+  free(oldCodepoints);
+  free(oldAdvances);
+}
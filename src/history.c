@@ -0,0 +1,241 @@
+#include "consolehck.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+/* Entries are UTF-8 strings packed back to back in one arena, offsets[i] is where entry first + i
+ * starts and offsets[count] where the next one will go. Dropping the oldest entry only advances first;
+ * the arena, the offsets and the search index are compacted once the dead front outgrows the live part.
+ * Entry ids count pushes since the last clear, the search index is keyed by them.
+ */
+
+static void consolehckHistoryDropOldest(consolehckHistory* history);
+static void consolehckHistoryCompact(consolehckHistory* history);
+static int consolehckHistoryContains(consolehckHistory const* history, unsigned int const index, char const* query, unsigned int const length);
+
+consolehckHistory* consolehckHistoryNew(unsigned int const maxEntries)
+{
+  consolehckHistory* const history = calloc(1, sizeof(consolehckHistory));
+  history->dataSize = 1024;
+  history->data = calloc(history->dataSize, sizeof(char));
+  history->offsetsSize = 64;
+  history->offsets = calloc(history->offsetsSize, sizeof(unsigned int));
+  history->first = 0;
+  history->count = 0;
+  history->firstId = 0;
+  history->maxEntries = maxEntries;
+  history->index = consolehckTrigramIndexNew();
+
+  return history;
+}
+
+void consolehckHistoryFree(consolehckHistory* history)
+{
+  consolehckTrigramIndexFree(history->index);
+  free(history->data);
+  free(history->offsets);
+  free(history);
+}
+
+void consolehckHistoryClear(consolehckHistory* history)
+{
+  history->first = 0;
+  history->count = 0;
+  history->firstId = 0;
+  history->offsets[0] = 0;
+  consolehckTrigramIndexClear(history->index);
+}
+
+void consolehckHistoryLimit(consolehckHistory* history, unsigned int const maxEntries)
+{
+  history->maxEntries = maxEntries;
+  while(history->maxEntries > 0 && history->count > history->maxEntries)
+  {
+    consolehckHistoryDropOldest(history);
+  }
+}
+
+unsigned int consolehckHistoryCount(consolehckHistory const* history)
+{
+  return history->count;
+}
+
+char const* consolehckHistoryGet(consolehckHistory const* history, unsigned int const index, unsigned int* length)
+{
+  unsigned int const start = history->offsets[history->first + index];
+  *length = history->offsets[history->first + index + 1] - start;
+  return history->data + start;
+}
+
+void consolehckHistoryPush(consolehckHistory* history, char const* c, unsigned int const length)
+{
+  // Empty lines and repeats of the newest entry are not recorded
+  if(length == 0)
+    return;
+
+  if(history->count > 0)
+  {
+    unsigned int lastLength;
+    char const* const last = consolehckHistoryGet(history, history->count - 1, &lastLength);
+    if(lastLength == length && memcmp(last, c, length) == 0)
+      return;
+  }
+
+  unsigned int const end = history->offsets[history->first + history->count];
+  if(end + length > history->dataSize)
+  {
+    consolehckHistoryCompact(history);
+  }
+
+  unsigned int const start = history->offsets[history->first + history->count];
+  if(start + length > history->dataSize)
+  {
+    while(start + length > history->dataSize)
+    {
+      history->dataSize *= 2;
+    }
+    history->data = realloc(history->data, history->dataSize);
+  }
+
+  if(history->first + history->count + 2 > history->offsetsSize)
+  {
+    history->offsetsSize *= 2;
+    history->offsets = realloc(history->offsets, history->offsetsSize * sizeof(unsigned int));
+  }
+
+  memcpy(history->data + start, c, length);
+  consolehckTrigramIndexAdd(history->index, history->firstId + history->count, c, length);
+  history->count += 1;
+  history->offsets[history->first + history->count] = start + length;
+
+  if(history->maxEntries > 0 && history->count > history->maxEntries)
+  {
+    consolehckHistoryDropOldest(history);
+  }
+}
+
+int consolehckHistorySearch(consolehckHistory const* history, char const* query, unsigned int const length, unsigned int const before)
+{
+  // Newest entry below index before that contains query, or -1
+  unsigned int const end = before < history->count ? before : history->count;
+  unsigned int const* postings;
+  unsigned int num;
+
+  if(consolehckTrigramIndexRarest(history->index, query, length, &postings, &num))
+  {
+    // Binary search the sorted postings for the first id at or after the end, then walk back
+    unsigned int const endId = history->firstId + end;
+    unsigned int low = 0;
+    unsigned int high = num;
+    while(low < high)
+    {
+      unsigned int const middle = low + (high - low) / 2;
+      if(postings[middle] < endId)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+
+    while(low > 0 && postings[low - 1] >= history->firstId)
+    {
+      --low;
+      unsigned int const index = postings[low] - history->firstId;
+      if(consolehckHistoryContains(history, index, query, length))
+        return index;
+    }
+
+    return -1;
+  }
+
+  // Queries shorter than a trigram match often, scan back until one does
+  unsigned int index = end;
+  while(index > 0)
+  {
+    --index;
+    if(consolehckHistoryContains(history, index, query, length))
+      return index;
+  }
+
+  return -1;
+}
+
+void consolehckHistoryMemory(consolehckHistory const* history, consolehckMemory* memory)
+{
+  // Without the search index, see consolehckTrigramIndexMemory
+  memory->used += sizeof(consolehckHistory) + history->offsets[history->first + history->count] - history->offsets[history->first];
+  memory->used += (history->count + 1) * sizeof(unsigned int);
+  memory->reserved += sizeof(consolehckHistory) + history->dataSize + history->offsetsSize * sizeof(unsigned int);
+}
+
+void consolehckHistoryTrim(consolehckHistory* history)
+{
+  // Compact, then shrink the arena to the live entries and the offsets to theirs and the next one's
+  consolehckHistoryCompact(history);
+
+  unsigned int const used = history->offsets[history->count];
+  unsigned int const dataSize = used > 0 ? used : 1;
+  if(history->dataSize > dataSize)
+  {
+    history->dataSize = dataSize;
+    history->data = realloc(history->data, history->dataSize);
+  }
+
+  if(history->offsetsSize > history->count + 1)
+  {
+    history->offsetsSize = history->count + 1;
+    history->offsets = realloc(history->offsets, history->offsetsSize * sizeof(unsigned int));
+  }
+
+  consolehckTrigramIndexTrim(history->index);
+}
+
+static void consolehckHistoryDropOldest(consolehckHistory* history)
+{
+  history->first += 1;
+  history->firstId += 1;
+  history->count -= 1;
+
+  if(history->first > history->count)
+  {
+    consolehckHistoryCompact(history);
+  }
+}
+
+static void consolehckHistoryCompact(consolehckHistory* history)
+{
+  // Move the live entries and their offsets to the front and forget the dropped ones in the index
+  if(history->first == 0)
+    return;
+
+  unsigned int const base = history->offsets[history->first];
+  unsigned int const end = history->offsets[history->first + history->count];
+  memmove(history->data, history->data + base, end - base);
+
+  unsigned int i;
+  for(i = 0; i <= history->count; ++i)
+  {
+    history->offsets[i] = history->offsets[history->first + i] - base;
+  }
+
+  history->first = 0;
+  consolehckTrigramIndexPrune(history->index, history->firstId);
+}
+
+static int consolehckHistoryContains(consolehckHistory const* history, unsigned int const index, char const* query, unsigned int const length)
+{
+  unsigned int entryLength;
+  char const* const entry = consolehckHistoryGet(history, index, &entryLength);
+
+  if(length == 0)
+    return 1;
+
+  unsigned int i;
+  for(i = 0; i + length <= entryLength; ++i)
+  {
+    if(entry[i] == query[0] && memcmp(entry + i, query, length) == 0)
+      return 1;
+  }
+
+  return 0;
+}
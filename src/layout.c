@@ -0,0 +1,733 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+/* Layout turns text into glyph runs positioned in a font, measured through the font metrics behind a
+ * glyph cache and never touching a renderer. Runs are batched by color as they are added, a backend
+ * draws each batch in one go. Batches and their buffers outlive a reset, so laying out every frame
+ * allocates only while the layout grows.
+ */
+
+static char const CURSOR[] = "_";
+// Row starts a line laid out on screen is wrapped into on the stack before it gets its own
+#define LAYOUT_LINE_ROWS 64
+
+static void consolehckLayoutAddText(consolehckLayout* layout, consolehckGlyphCache* glyphs, glhckColorb const color, float x, float const y, char const* c, unsigned int const length);
+static unsigned int consolehckLayoutLine(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const lineIndex, int const rows);
+static unsigned int consolehckLayoutLineRows(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const lineIndex);
+static void consolehckLayoutCountRows(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const from);
+static unsigned int consolehckLayoutSeek(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const skip, unsigned int* skipped);
+static void consolehckLayoutRow(consolehckLayout* layout, consolehckGlyphCache* glyphs, float const x, float const y,
+                                char const* lineData, unsigned int const lineLength, unsigned int const rowStart, unsigned int const rowEnd,
+                                consolehckScrollback const* text, unsigned int const lineByte, consolehckTextColors const* colors);
+static unsigned int consolehckLayoutFindHighlight(char const* lineData, unsigned int const lineLength, consolehckTextColors const* colors, unsigned int from, unsigned int const before);
+static glhckColorb consolehckLayoutColor(consolehckStyle const* style, consolehckTextColors const* colors);
+static unsigned int consolehckLayoutInputScroll(consolehckGlyphCache* glyphs, consolehckGapBuffer const* input, unsigned int first, float const available);
+static float consolehckNullAdvance(void* userData, unsigned int const fontId, unsigned int const fontSize, unsigned int const codepoint);
+static int consolehckColorEqual(glhckColorb const a, glhckColorb const b);
+
+consolehckLayout* consolehckLayoutNew(void)
+{
+  consolehckLayout* const layout = calloc(1, sizeof(consolehckLayout));
+  layout->stats = NULL;
+  layout->fontId = 0;
+  layout->fontSize = 0;
+  layout->batches = NULL;
+  layout->numBatches = 0;
+  layout->batchesSize = 0;
+
+  return layout;
+}
+
+void consolehckLayoutFree(consolehckLayout* layout)
+{
+  unsigned int i;
+  for(i = 0; i < layout->batchesSize; ++i)
+  {
+    free(layout->batches[i].runs);
+    free(layout->batches[i].text);
+  }
+
+  free(layout->batches);
+  free(layout);
+}
+
+void consolehckLayoutReset(consolehckLayout* layout, unsigned int const fontId, unsigned int const fontSize)
+{
+  layout->fontId = fontId;
+  layout->fontSize = fontSize;
+  layout->numBatches = 0;
+}
+
+void consolehckLayoutAdd(consolehckLayout* layout, glhckColorb const color, float const x, float const y, char const* c, unsigned int const length)
+{
+  // Few colors are on screen at once, a linear search finds the batch of a color
+  unsigned int i = 0;
+  while(i < layout->numBatches && !consolehckColorEqual(layout->batches[i].color, color))
+    ++i;
+
+  if(i == layout->numBatches)
+  {
+    if(layout->numBatches == layout->batchesSize)
+    {
+      layout->batchesSize = layout->batchesSize > 0 ? layout->batchesSize * 2 : 4;
+      layout->batches = realloc(layout->batches, layout->batchesSize * sizeof(consolehckGlyphBatch));
+      consolehckStatsAllocated(layout->stats, layout->batchesSize * sizeof(consolehckGlyphBatch));
+      memset(layout->batches + layout->numBatches, 0, (layout->batchesSize - layout->numBatches) * sizeof(consolehckGlyphBatch));
+    }
+
+    // Batches past the used ones keep their buffers from earlier layouts
+    layout->batches[i].color = color;
+    layout->batches[i].numRuns = 0;
+    layout->batches[i].textLength = 0;
+    layout->numBatches += 1;
+  }
+
+  consolehckGlyphBatch* const batch = &layout->batches[i];
+  if(batch->textLength + length + 1 > batch->textSize)
+  {
+    while(batch->textLength + length + 1 > batch->textSize)
+    {
+      batch->textSize = batch->textSize > 0 ? batch->textSize * 2 : 256;
+    }
+    batch->text = realloc(batch->text, batch->textSize);
+    consolehckStatsAllocated(layout->stats, batch->textSize);
+  }
+
+  if(batch->numRuns == batch->runsSize)
+  {
+    batch->runsSize = batch->runsSize > 0 ? batch->runsSize * 2 : 16;
+    batch->runs = realloc(batch->runs, batch->runsSize * sizeof(consolehckGlyphRun));
+    consolehckStatsAllocated(layout->stats, batch->runsSize * sizeof(consolehckGlyphRun));
+  }
+
+  consolehckGlyphRun* const run = &batch->runs[batch->numRuns];
+  run->x = x;
+  run->y = y;
+  run->start = batch->textLength;
+  run->length = length;
+  batch->numRuns += 1;
+
+  memcpy(batch->text + batch->textLength, c, length);
+  batch->text[batch->textLength + length] = '\0';
+  batch->textLength += length + 1;
+}
+
+void consolehckLayoutOutput(consolehckLayout* layout, consolehckGlyphCache* glyphs, glhckRect const* rect, int const offset, consolehckWrapMode wrapMode, consolehckScrollback* text, consolehckTextColors const* colors)
+{
+  /* Work through the indexed lines backwards starting from the last one below the visible area.
+   * Each line's wrap-lines are computed once for the current width and font and cached on the line,
+   * lines below the visible area are skipped by the running row counts of consolehckLayoutSeek.
+   * Visible wrap-lines are laid out from the last one up.
+   */
+  unsigned long long const begin = consolehckStatsBegin(layout->stats);
+  unsigned int const fontSize = layout->fontSize;
+  consolehckGlyphCacheFont(glyphs, layout->fontId, fontSize);
+  consolehckScrollbackLayout(text, rect->w, layout->fontId, fontSize);
+
+  int const lineOffset = offset % (int) fontSize;
+  int const firstVisibleLine = offset / (int) fontSize + 1;
+  unsigned int const numVisibleLines = rect->h / fontSize + 1;
+  int const lastVisibleLine = firstVisibleLine + (int) numVisibleLines - 1;
+  unsigned int lineIndex = consolehckScrollbackLineCount(text);
+  int currentLine = 1;
+
+  // The open last line is empty right after a newline and gets no row of its own
+  if(consolehckScrollbackGetLine(text, lineIndex - 1)->length == 0)
+  {
+    --lineIndex;
+  }
+
+  // Without wrapping every line is one row, so lines below the visible area can be skipped outright
+  if(wrapMode == CONSOLEHCK_NO_WRAP && firstVisibleLine > currentLine)
+  {
+    unsigned int const skipped = (unsigned int) (firstVisibleLine - currentLine) < lineIndex ? (unsigned int) (firstVisibleLine - currentLine) : lineIndex;
+    lineIndex -= skipped;
+    currentLine += skipped;
+  }
+  else if(wrapMode == CONSOLEHCK_WRAP && firstVisibleLine > currentLine && lineIndex > 0)
+  {
+    unsigned int skipped;
+    lineIndex = consolehckLayoutSeek(glyphs, rect->w, text, firstVisibleLine - currentLine, &skipped);
+    currentLine += skipped;
+  }
+
+  while(lastVisibleLine > currentLine && lineIndex > 0)
+  {
+    --lineIndex;
+    consolehckLine* const line = consolehckScrollbackGetLine(text, lineIndex);
+    unsigned int const lineLength = line->length;
+
+    // Skip empty lines
+    if(lineLength == 0)
+    {
+      ++currentLine;
+      continue;
+    }
+
+    unsigned int numRows = 1;
+
+    if(wrapMode == CONSOLEHCK_WRAP)
+    {
+      // Past the seek every line reaches into the visible area
+      numRows = consolehckLayoutLine(glyphs, rect->w, text, lineIndex, 1);
+    }
+
+    // Lines entirely below the visible area only advance the row counter
+    if(currentLine + (int) numRows <= firstVisibleLine)
+    {
+      currentLine += numRows;
+      continue;
+    }
+
+    // Copy the visible line out of the ring as a null-terminated UTF-8 string
+    char* const lineData = calloc(lineLength + 1, sizeof(char));
+    consolehckStatsAllocated(layout->stats, lineLength + 1);
+    consolehckScrollbackCopyLine(text, lineIndex, lineData);
+
+    // Lay out wrap-lines from the last one up
+    unsigned int const lineByte = (line->start + text->bufferSize - text->start) % text->bufferSize;
+    unsigned int rowEnd = lineLength;
+    while(lastVisibleLine > currentLine && numRows > 0)
+    {
+      --numRows;
+      unsigned int const rowStart = numRows > 0 ? line->rowStarts[numRows] : 0;
+      float const lineY = rect->h - (currentLine - firstVisibleLine + 1) * fontSize + lineOffset;
+      if(currentLine >= firstVisibleLine)
+      {
+        consolehckLayoutRow(layout, glyphs, rect->x, rect->y + lineY, lineData, lineLength, rowStart, rowEnd, text, lineByte, colors);
+        if(layout->stats != NULL)
+        {
+          layout->stats->rowsLaidOut += 1;
+        }
+      }
+      rowEnd = rowStart;
+      ++currentLine;
+    }
+
+    free(lineData);
+  }
+
+  consolehckStatsEnd(layout->stats, CONSOLEHCK_PHASE_LAYOUT, begin);
+}
+
+void consolehckLayoutInput(consolehckLayout* layout, consolehckGlyphCache* glyphs, float const x, float const y, float const right,
+                           char const* prompt, unsigned int const promptLength, consolehckGapBuffer* input, unsigned int* scroll, glhckColorb const color)
+{
+  /* The prompt followed by as much of the input as fits before right and the cursor.
+   * The first visible codepoint is kept in scroll between layouts, see consolehckLayoutInputScroll.
+   */
+  unsigned long long const begin = consolehckStatsBegin(layout->stats);
+  consolehckGlyphCacheFont(glyphs, layout->fontId, layout->fontSize);
+
+  float promptRight = x;
+  if(promptLength > 0)
+  {
+    consolehckLayoutAddText(layout, glyphs, color, x, y, prompt, promptLength);
+    promptRight += consolehckGlyphCacheStringWidth(glyphs, prompt, promptLength);
+  }
+
+  unsigned int const inputLength = consolehckGapBufferLength(input);
+  unsigned int const cursor = consolehckGapBufferCursor(input);
+  float const available = right - promptRight;
+  unsigned int const first = consolehckLayoutInputScroll(glyphs, input, *scroll, available);
+  *scroll = first;
+
+  // Walk forward from the first visible codepoint once, placing the cursor and finding the last one that fits
+  float inputX = 0.0f;
+  float cursorX = 0.0f;
+  unsigned int last = first;
+  while(last < inputLength)
+  {
+    if(last == cursor)
+    {
+      cursorX = inputX;
+    }
+    inputX += consolehckGlyphCacheAdvance(glyphs, consolehckGapBufferGet(input, last));
+    if(inputX > available && last > cursor)
+      break;
+    ++last;
+  }
+  if(cursor == last)
+  {
+    cursorX = inputX;
+  }
+
+  if(last > first)
+  {
+    // Encode only the visible codepoints, which may lie on both sides of the gap
+    unsigned long long const encodeBegin = consolehckStatsBegin(layout->stats);
+    unsigned int const beforeEnd = last < cursor ? last : cursor;
+    unsigned int const beforeNum = first < beforeEnd ? beforeEnd - first : 0;
+    unsigned int const afterStart = first > cursor ? first : cursor;
+    unsigned int const afterNum = last > afterStart ? last - afterStart : 0;
+    unsigned int const* const before = input->data + first;
+    unsigned int const* const after = input->data + input->gapEnd + (afterStart - cursor);
+
+    int const utf8BeforeLength = utf8EncodedStringLengthN(before, beforeNum);
+    int const utf8VisibleLength = utf8BeforeLength + utf8EncodedStringLengthN(after, afterNum);
+    char* const utf8Visible = calloc(utf8VisibleLength + 1, 1);
+    utf8EncodeStringN(before, beforeNum, utf8Visible);
+    utf8EncodeStringN(after, afterNum, utf8Visible + utf8BeforeLength);
+    consolehckStatsAllocated(layout->stats, utf8VisibleLength + 1);
+    consolehckStatsEnd(layout->stats, CONSOLEHCK_PHASE_ENCODE, encodeBegin);
+
+    consolehckLayoutAddText(layout, glyphs, color, promptRight, y, utf8Visible, utf8VisibleLength);
+    free(utf8Visible);
+  }
+
+  // Cursor goes under the codepoint it is in front of
+  consolehckLayoutAdd(layout, color, promptRight + cursorX, y, CURSOR, sizeof(CURSOR) - 1);
+
+  if(layout->stats != NULL)
+  {
+    layout->stats->rowsLaidOut += 1;
+  }
+  consolehckStatsEnd(layout->stats, CONSOLEHCK_PHASE_LAYOUT, begin);
+}
+
+unsigned int consolehckTextRowOf(consolehckGlyphCache* glyphs, float const width, unsigned int fontId, unsigned int fontSize, consolehckScrollback* text, unsigned int const line, unsigned int const byte)
+{
+  // Count the wrapped rows of the lines below line the way consolehckLayoutOutput does, from the running counts
+  consolehckGlyphCacheFont(glyphs, fontId, fontSize);
+  consolehckScrollbackLayout(text, width, fontId, fontSize);
+
+  unsigned int const openLine = consolehckScrollbackLineCount(text) - 1;
+  unsigned int row = 1;
+  if(line < openLine)
+  {
+    consolehckLayoutCountRows(glyphs, width, text, line + 1);
+    consolehckLine const* const open = consolehckScrollbackGetLine(text, openLine);
+    row += open->rowsAbove - consolehckScrollbackGetLine(text, line + 1)->rowsAbove;
+
+    // The open last line is empty right after a newline and gets no row of its own
+    if(open->length > 0)
+    {
+      row += consolehckLayoutLine(glyphs, width, text, openLine, 0);
+    }
+  }
+
+  consolehckLine const* const l = consolehckScrollbackGetLine(text, line);
+  if(l->length == 0)
+    return row;
+
+  unsigned int numRows = consolehckLayoutLine(glyphs, width, text, line, 1);
+  while(numRows > 1 && l->rowStarts[numRows - 1] > byte)
+  {
+    --numRows;
+    ++row;
+  }
+
+  return row;
+}
+
+consolehckFontMetrics consolehckNullFontMetrics(void)
+{
+  consolehckFontMetrics const metrics = {consolehckNullAdvance, NULL};
+  return metrics;
+}
+
+void consolehckLayoutMemory(consolehckLayout const* layout, consolehckMemory* memory)
+{
+  // Buffers of batches past numBatches are kept for reuse and only count as reserved
+  memory->used += sizeof(consolehckLayout) + layout->numBatches * sizeof(consolehckGlyphBatch);
+  memory->reserved += sizeof(consolehckLayout) + layout->batchesSize * sizeof(consolehckGlyphBatch);
+
+  unsigned int i;
+  for(i = 0; i < layout->batchesSize; ++i)
+  {
+    consolehckGlyphBatch const* const batch = &layout->batches[i];
+    if(i < layout->numBatches)
+    {
+      memory->used += batch->numRuns * sizeof(consolehckGlyphRun) + batch->textLength;
+    }
+    memory->reserved += batch->runsSize * sizeof(consolehckGlyphRun) + batch->textSize;
+  }
+}
+
+void consolehckLayoutTrim(consolehckLayout* layout)
+{
+  // Free the batches left over from earlier layouts and shrink the rest to what the last one laid out
+  unsigned int i;
+  for(i = layout->numBatches; i < layout->batchesSize; ++i)
+  {
+    free(layout->batches[i].runs);
+    free(layout->batches[i].text);
+  }
+
+  for(i = 0; i < layout->numBatches; ++i)
+  {
+    consolehckGlyphBatch* const batch = &layout->batches[i];
+    if(batch->textSize > batch->textLength)
+    {
+      batch->textSize = batch->textLength;
+      batch->text = realloc(batch->text, batch->textSize);
+    }
+    if(batch->runsSize > batch->numRuns)
+    {
+      batch->runsSize = batch->numRuns;
+      batch->runs = realloc(batch->runs, batch->runsSize * sizeof(consolehckGlyphRun));
+    }
+  }
+
+  if(layout->numBatches == 0)
+  {
+    free(layout->batches);
+    layout->batches = NULL;
+    layout->batchesSize = 0;
+  }
+  else if(layout->batchesSize > layout->numBatches)
+  {
+    layout->batchesSize = layout->numBatches;
+    layout->batches = realloc(layout->batches, layout->batchesSize * sizeof(consolehckGlyphBatch));
+  }
+}
+
+static void consolehckLayoutAddText(consolehckLayout* layout, consolehckGlyphCache* glyphs, glhckColorb const color, float x, float const y, char const* c, unsigned int const length)
+{
+  /* In a fixed-width font glyphs sit in cells, but a renderer advances by the glyphs' own widths, which
+   * differ from their cells for wide and zero-width characters. Text is cut around those so every run
+   * starts on its cell, text of single cell glyphs and text in proportional fonts is added whole.
+   * c must be followed by a zero byte so a truncated sequence can't read past it.
+   */
+  if(glyphs->cellWidth <= 0.0f)
+  {
+    consolehckLayoutAdd(layout, color, x, y, c, length);
+    return;
+  }
+
+  unsigned int start = 0;
+  unsigned int columns = 0;
+  unsigned int i = 0;
+  while(i < length)
+  {
+    if((unsigned char) c[i] < 0x80)
+    {
+      ++columns;
+      ++i;
+      continue;
+    }
+
+    int const charLength = utf8GetValidatedCharLength(c + i);
+    unsigned int const charColumns = charLength > 1 ? consolehckGlyphColumns(utf8GetChar(c + i)) : 1;
+    if(charColumns != 1)
+    {
+      if(i > start)
+      {
+        consolehckLayoutAdd(layout, color, x, y, c + start, i - start);
+      }
+      x += columns * glyphs->cellWidth;
+      consolehckLayoutAdd(layout, color, x, y, c + i, charLength);
+      x += charColumns * glyphs->cellWidth;
+      start = i + charLength;
+      columns = 0;
+    }
+    else
+    {
+      ++columns;
+    }
+    i += charLength;
+  }
+
+  if(start < length)
+  {
+    consolehckLayoutAdd(layout, color, x, y, c + start, length - start);
+  }
+}
+
+static unsigned int consolehckLayoutLine(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const lineIndex, int const rows)
+{
+  /* Number of wrap-lines of a non-empty line, laid out again only when its cached layout is stale.
+   * Lines off screen are only counted, the starts of their rows are found once rows asks for them,
+   * so a line that wraps has rowStarts NULL until then.
+   */
+  consolehckLine* const line = consolehckScrollbackGetLine(text, lineIndex);
+  unsigned int const lineLength = line->length;
+  int const counted = line->layoutKey == text->layoutKey;
+  if(counted && (!rows || line->numRows == 1 || line->rowStarts != NULL))
+    return line->numRows;
+
+  // Wrap the line where it lies in the ring, row starts go on the stack first when they are asked for
+  char const* const data = consolehckScrollbackLineText(text, lineIndex);
+  unsigned int rowStarts[LAYOUT_LINE_ROWS];
+  unsigned int const maxRows = rows && !counted ? LAYOUT_LINE_ROWS : 0;
+  if(!counted)
+  {
+    free(line->rowStarts);
+    line->rowStarts = NULL;
+    line->numRows = consolehckGlyphCacheWrap(glyphs, data, lineLength, width, rowStarts, maxRows);
+    line->layoutKey = text->layoutKey;
+
+    if(glyphs->stats != NULL)
+    {
+      glyphs->stats->linesLaidOut += 1;
+    }
+  }
+
+  if(rows && line->numRows > 1)
+  {
+    // Lines of more rows than the stack holds or only counted before are wrapped again straight into the cache
+    line->rowStarts = malloc(line->numRows * sizeof(unsigned int));
+    consolehckStatsAllocated(glyphs->stats, line->numRows * sizeof(unsigned int));
+    if(line->numRows <= maxRows)
+    {
+      memcpy(line->rowStarts, rowStarts, line->numRows * sizeof(unsigned int));
+    }
+    else
+    {
+      consolehckGlyphCacheWrap(glyphs, data, lineLength, width, line->rowStarts, line->numRows);
+    }
+  }
+
+  return line->numRows;
+}
+
+static unsigned int consolehckLayoutSeek(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const skip, unsigned int* skipped)
+{
+  /* First line of the run of last lines that together take at most skip rows, and their rows in skipped.
+   * The rows of the lines from line to the bottom are the difference of running counts plus the open line,
+   * the count range is grown up only until it reaches a line that doesn't fit in skip, then binary searched.
+   */
+  unsigned int const openLine = consolehckScrollbackLineCount(text) - 1;
+  consolehckLine const* const open = consolehckScrollbackGetLine(text, openLine);
+  unsigned int const openRows = open->length > 0 ? consolehckLayoutLine(glyphs, width, text, openLine, 0) : 0;
+  if(openRows > skip)
+  {
+    *skipped = 0;
+    return openLine + 1;
+  }
+
+  consolehckLayoutCountRows(glyphs, width, text, openLine);
+  unsigned int first = text->rowsFirstId - text->firstLineId;
+  while(first > 0 && open->rowsAbove - consolehckScrollbackGetLine(text, first)->rowsAbove + openRows <= skip)
+  {
+    --first;
+    consolehckLayoutCountRows(glyphs, width, text, first);
+  }
+
+  // Rows below are nonincreasing in the line, find the first line where they fit
+  unsigned int low = first;
+  unsigned int high = openLine;
+  while(low < high)
+  {
+    unsigned int const middle = low + (high - low) / 2;
+    if(open->rowsAbove - consolehckScrollbackGetLine(text, middle)->rowsAbove + openRows <= skip)
+      high = middle;
+    else
+      low = middle + 1;
+  }
+
+  *skipped = open->rowsAbove - consolehckScrollbackGetLine(text, low)->rowsAbove + openRows;
+  return low;
+}
+
+static unsigned int consolehckLayoutLineRows(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const lineIndex)
+{
+  // Empty lines still take a row
+  if(consolehckScrollbackGetLine(text, lineIndex)->length == 0)
+    return 1;
+
+  return consolehckLayoutLine(glyphs, width, text, lineIndex, 0);
+}
+
+static void consolehckLayoutCountRows(consolehckGlyphCache* glyphs, float const width, consolehckScrollback* text, unsigned int const from)
+{
+  /* Extend the range of lines with running row counts to cover from up to the open last line.
+   * Only complete lines are summed, their text and so their rows never change within a layout generation.
+   * The range starts over where it is needed after the layout changes or all its lines are dropped,
+   * then grows up towards earlier lines asked for and down as lines are completed, so each line is
+   * laid out and counted once per generation however often rows are looked up.
+   */
+  unsigned int const firstId = text->firstLineId;
+  unsigned int const fromId = firstId + from;
+  unsigned int const openId = firstId + text->numLines;
+
+  if(text->rowsKey != text->layoutKey || text->rowsEndId <= firstId)
+  {
+    text->rowsKey = text->layoutKey;
+    text->rowsFirstId = fromId;
+    text->rowsEndId = fromId + 1;
+    consolehckScrollbackGetLine(text, from)->rowsAbove = 0;
+  }
+  else if(text->rowsFirstId < firstId)
+  {
+    text->rowsFirstId = firstId;
+  }
+
+  // Counts wrap around below the base, differences stay right in unsigned arithmetic
+  while(text->rowsFirstId > fromId)
+  {
+    unsigned int const lineIndex = text->rowsFirstId - 1 - firstId;
+    unsigned int const below = consolehckScrollbackGetLine(text, lineIndex + 1)->rowsAbove;
+    consolehckScrollbackGetLine(text, lineIndex)->rowsAbove = below - consolehckLayoutLineRows(glyphs, width, text, lineIndex);
+    text->rowsFirstId -= 1;
+  }
+
+  while(text->rowsEndId <= openId)
+  {
+    unsigned int const lineIndex = text->rowsEndId - firstId;
+    unsigned int const above = consolehckScrollbackGetLine(text, lineIndex - 1)->rowsAbove;
+    consolehckScrollbackGetLine(text, lineIndex)->rowsAbove = above + consolehckLayoutLineRows(glyphs, width, text, lineIndex - 1);
+    text->rowsEndId += 1;
+  }
+}
+
+static void consolehckLayoutRow(consolehckLayout* layout, consolehckGlyphCache* glyphs, float const x, float const y,
+                                char const* lineData, unsigned int const lineLength, unsigned int const rowStart, unsigned int const rowEnd,
+                                consolehckScrollback const* text, unsigned int const lineByte, consolehckTextColors const* colors)
+{
+  /* Lay out the row [rowStart, rowEnd) of a line starting at byte lineByte of the text.
+   * The row is cut into runs where the style changes and around occurrences of the highlight, including
+   * ones that continue from the previous row or into the next. A row in one color is added whole without
+   * measuring it.
+   */
+  unsigned int const length = colors->highlight != NULL ? colors->highlightLength : 0;
+  unsigned int match = consolehckLayoutFindHighlight(lineData, lineLength, colors, rowStart >= length ? rowStart - length + 1 : 0, rowEnd);
+  consolehckStyle const* style = NULL;
+  unsigned int styleEnd = 0;
+  unsigned int segment = rowStart;
+  float segmentX = x;
+
+  while(segment < rowEnd)
+  {
+    if(lineByte + segment >= styleEnd)
+    {
+      style = consolehckScrollbackStyleAt(text, lineByte + segment, &styleEnd);
+    }
+
+    unsigned int end = rowEnd;
+    glhckColorb color;
+    if(match <= segment)
+    {
+      end = match + length < end ? match + length : end;
+      color = colors->highlightColor;
+    }
+    else
+    {
+      end = match < end ? match : end;
+      end = styleEnd - lineByte < end ? styleEnd - lineByte : end;
+      color = consolehckLayoutColor(style, colors);
+    }
+
+    consolehckLayoutAddText(layout, glyphs, color, segmentX, y, lineData + segment, end - segment);
+
+    if(end < rowEnd)
+    {
+      segmentX += consolehckGlyphCacheStringWidth(glyphs, lineData + segment, end - segment);
+    }
+
+    segment = end;
+    if(match < lineLength && match + length <= segment)
+    {
+      match = consolehckLayoutFindHighlight(lineData, lineLength, colors, match + length, rowEnd);
+    }
+  }
+}
+
+static unsigned int consolehckLayoutFindHighlight(char const* lineData, unsigned int const lineLength, consolehckTextColors const* colors, unsigned int from, unsigned int const before)
+{
+  // Start of the first occurrence of the highlight at or after from that starts before before, lineLength when there is none
+  unsigned int const length = colors->highlight != NULL ? colors->highlightLength : 0;
+  while(length > 0 && from < before && from + length <= lineLength)
+  {
+    char const* const candidate = memchr(lineData + from, colors->highlight[0], lineLength - length - from + 1);
+    if(candidate == NULL || (unsigned int) (candidate - lineData) >= before)
+      break;
+
+    from = candidate - lineData;
+    if(memcmp(candidate, colors->highlight, length) == 0)
+      return from;
+    ++from;
+  }
+
+  return lineLength;
+}
+
+static glhckColorb consolehckLayoutColor(consolehckStyle const* style, consolehckTextColors const* colors)
+{
+  // Color the glyphs of a style are drawn in. Cells get no background of their own, a background color shows as inverse text.
+  if(style == NULL)
+    return colors->foreground;
+
+  glhckColorb color = style->attributes & CONSOLEHCK_ATTRIBUTE_FOREGROUND ? style->foreground : colors->foreground;
+  if(style->attributes & CONSOLEHCK_ATTRIBUTE_INVERSE)
+  {
+    color = style->attributes & CONSOLEHCK_ATTRIBUTE_BACKGROUND ? style->background : colors->background;
+  }
+
+  if(style->attributes & CONSOLEHCK_ATTRIBUTE_DIM)
+  {
+    color.r = color.r * 2 / 3;
+    color.g = color.g * 2 / 3;
+    color.b = color.b * 2 / 3;
+  }
+
+  return color;
+}
+
+static unsigned int consolehckLayoutInputScroll(consolehckGlyphCache* glyphs, consolehckGapBuffer const* input, unsigned int first, float const available)
+{
+  /* The first visible input codepoint is kept between frames and only adjusted when it has to move:
+   * back while the tail of the input would leave room on the right, and forward when the cursor
+   * would not fit. Each adjustment accumulates cached advances backwards from the end or from the
+   * cursor and stops at the first codepoint that no longer fits, so the cost is bounded by the
+   * visible width rather than the length of the input.
+   */
+  unsigned int const inputLength = consolehckGapBufferLength(input);
+  unsigned int const cursor = consolehckGapBufferCursor(input);
+  float x;
+
+  if(first > 0)
+  {
+    unsigned int tailStart = inputLength;
+    x = consolehckGlyphCacheAdvance(glyphs, CURSOR[0]);
+    while(tailStart > 0)
+    {
+      x += consolehckGlyphCacheAdvance(glyphs, consolehckGapBufferGet(input, tailStart - 1));
+      if(x > available)
+        break;
+      --tailStart;
+    }
+    if(tailStart < first)
+    {
+      first = tailStart;
+    }
+  }
+
+  if(cursor < first)
+  {
+    first = cursor;
+  }
+  else
+  {
+    unsigned int cursorStart = cursor;
+    x = consolehckGlyphCacheAdvance(glyphs, cursor < inputLength ? consolehckGapBufferGet(input, cursor) : (unsigned int) CURSOR[0]);
+    while(cursorStart > first)
+    {
+      x += consolehckGlyphCacheAdvance(glyphs, consolehckGapBufferGet(input, cursorStart - 1));
+      if(x > available)
+        break;
+      --cursorStart;
+    }
+    first = cursorStart;
+  }
+
+  return first;
+}
+
+static float consolehckNullAdvance(void* userData, unsigned int const fontId, unsigned int const fontSize, unsigned int const codepoint)
+{
+  // Every glyph is half the font size wide
+  (void) userData;
+  (void) fontId;
+  (void) codepoint;
+  return fontSize / 2.0f;
+}
+
+static int consolehckColorEqual(glhckColorb const a, glhckColorb const b)
+{
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
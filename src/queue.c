@@ -0,0 +1,205 @@
+#include "consolehck.h"
+
+#include <stdatomic.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Multi-producer single-consumer queue of output messages.
+ * Producers link messages in with a single atomic exchange on the head (Vyukov's intrusive MPSC queue),
+ * the consumer unlinks them from the tail without any atomic read-modify-write.
+ * Message storage is carved out of a slab owned by the producing thread. Every message holds a
+ * reference on its slab, so the consumer frees a retired slab once its last message is drained and
+ * a producer reuses its slab in place once everything carved from it has been consumed.
+ */
+
+#define CONSOLEHCK_QUEUE_SLAB_SIZE 65536
+#define CONSOLEHCK_QUEUE_ALIGN(x) (((x) + alignof(consolehckQueueNode) - 1) & ~(alignof(consolehckQueueNode) - 1))
+
+typedef struct consolehckQueueSlab {
+  atomic_uint refs;
+  unsigned int size;
+  unsigned int used;
+} consolehckQueueSlab;
+
+typedef struct consolehckQueueNode {
+  struct consolehckQueueNode* _Atomic next;
+  consolehckQueueSlab* slab;
+  unsigned int length;
+} consolehckQueueNode;
+
+struct consolehckQueue {
+  consolehckQueueNode* _Atomic head;
+  consolehckQueueNode* tail;
+  consolehckQueueNode stub;
+};
+
+// Slab messages from the calling thread are currently carved from
+static _Thread_local consolehckQueueSlab* threadSlab = NULL;
+
+static consolehckQueueSlab* consolehckQueueSlabNew(unsigned int const size);
+static void consolehckQueueSlabRelease(consolehckQueueSlab* slab);
+static consolehckQueueNode* consolehckQueueNodeNew(unsigned int const length);
+static void consolehckQueueLink(consolehckQueue* queue, consolehckQueueNode* node);
+static consolehckQueueNode* consolehckQueueUnlink(consolehckQueue* queue);
+
+consolehckQueue* consolehckQueueNew(void)
+{
+  consolehckQueue* const queue = calloc(1, sizeof(consolehckQueue));
+  atomic_init(&queue->stub.next, NULL);
+  atomic_init(&queue->head, &queue->stub);
+  queue->tail = &queue->stub;
+
+  return queue;
+}
+
+void consolehckQueueFree(consolehckQueue* queue)
+{
+  consolehckQueueNode* node;
+  while((node = consolehckQueueUnlink(queue)) != NULL)
+  {
+    consolehckQueueSlabRelease(node->slab);
+  }
+
+  free(queue);
+}
+
+void consolehckQueuePush(consolehckQueue* queue, char const* c, unsigned int const length)
+{
+  consolehckQueueNode* const node = consolehckQueueNodeNew(length);
+  memcpy(node + 1, c, length);
+  consolehckQueueLink(queue, node);
+}
+
+unsigned int consolehckQueueDrain(consolehckQueue* queue, consolehckScrollback* scrollback)
+{
+  // Messages a producer is still in the middle of linking in are left for the next drain
+  unsigned int drained = 0;
+  consolehckQueueNode* node;
+  while((node = consolehckQueueUnlink(queue)) != NULL)
+  {
+    consolehckScrollbackPushStringN(scrollback, (char const*) (node + 1), node->length);
+    drained += node->length;
+    consolehckQueueSlabRelease(node->slab);
+  }
+
+  return drained;
+}
+
+void consolehckQueueThreadRelease(void)
+{
+  if(threadSlab != NULL)
+  {
+    consolehckQueueSlabRelease(threadSlab);
+    threadSlab = NULL;
+  }
+}
+
+static consolehckQueueSlab* consolehckQueueSlabNew(unsigned int const size)
+{
+  consolehckQueueSlab* const slab = malloc(CONSOLEHCK_QUEUE_ALIGN(sizeof(consolehckQueueSlab)) + size);
+  atomic_init(&slab->refs, 1);
+  slab->size = size;
+  slab->used = 0;
+
+  return slab;
+}
+
+static void consolehckQueueSlabRelease(consolehckQueueSlab* slab)
+{
+  if(atomic_fetch_sub_explicit(&slab->refs, 1, memory_order_acq_rel) == 1)
+  {
+    free(slab);
+  }
+}
+
+static consolehckQueueNode* consolehckQueueNodeNew(unsigned int const length)
+{
+  unsigned int const size = CONSOLEHCK_QUEUE_ALIGN(sizeof(consolehckQueueNode) + length);
+  consolehckQueueSlab* slab;
+
+  if(size > CONSOLEHCK_QUEUE_SLAB_SIZE)
+  {
+    // Oversized messages get a slab of their own, referenced by the message only
+    slab = consolehckQueueSlabNew(size);
+  }
+  else
+  {
+    slab = threadSlab;
+    if(slab != NULL && slab->used + size > slab->size)
+    {
+      if(atomic_load_explicit(&slab->refs, memory_order_acquire) == 1)
+      {
+        // Every message carved from the slab has been consumed, start over from its beginning
+        slab->used = 0;
+      }
+      else
+      {
+        // Retire it, the consumer frees it along with its last message
+        consolehckQueueSlabRelease(slab);
+        slab = NULL;
+      }
+    }
+
+    if(slab == NULL)
+    {
+      slab = consolehckQueueSlabNew(CONSOLEHCK_QUEUE_SLAB_SIZE);
+      threadSlab = slab;
+    }
+
+    atomic_fetch_add_explicit(&slab->refs, 1, memory_order_relaxed);
+  }
+
+  consolehckQueueNode* const node = (consolehckQueueNode*) ((char*) slab + CONSOLEHCK_QUEUE_ALIGN(sizeof(consolehckQueueSlab)) + slab->used);
+  slab->used += size;
+  atomic_init(&node->next, NULL);
+  node->slab = slab;
+  node->length = length;
+
+  return node;
+}
+
+static void consolehckQueueLink(consolehckQueue* queue, consolehckQueueNode* node)
+{
+  atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+  consolehckQueueNode* const prev = atomic_exchange_explicit(&queue->head, node, memory_order_acq_rel);
+  atomic_store_explicit(&prev->next, node, memory_order_release);
+}
+
+static consolehckQueueNode* consolehckQueueUnlink(consolehckQueue* queue)
+{
+  consolehckQueueNode* tail = queue->tail;
+  consolehckQueueNode* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+
+  // Step over the stub node, it only keeps the list non-empty
+  if(tail == &queue->stub)
+  {
+    if(next == NULL)
+      return NULL;
+
+    queue->tail = next;
+    tail = next;
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  }
+
+  if(next != NULL)
+  {
+    queue->tail = next;
+    return tail;
+  }
+
+  // tail looks like the last node, but a producer may have swapped the head without linking yet
+  if(tail != atomic_load_explicit(&queue->head, memory_order_acquire))
+    return NULL;
+
+  // Put the stub back behind the last node so it can be handed out
+  consolehckQueueLink(queue, &queue->stub);
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if(next != NULL)
+  {
+    queue->tail = next;
+    return tail;
+  }
+
+  return NULL;
+}
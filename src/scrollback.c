@@ -0,0 +1,1090 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+#include <stdio.h>
+
+static void consolehckScrollbackResize(consolehckScrollback* scrollback, unsigned int const newSize);
+static void consolehckScrollbackResizeLines(consolehckScrollback* scrollback, unsigned int const newSize);
+static void consolehckScrollbackNewLine(consolehckScrollback* scrollback);
+static void consolehckScrollbackDropLine(consolehckScrollback* scrollback);
+static void consolehckScrollbackDropChars(consolehckScrollback* scrollback, unsigned int const num);
+static void consolehckScrollbackReserve(consolehckScrollback* scrollback, unsigned int const num);
+static void consolehckScrollbackEnforceLineLimit(consolehckScrollback* scrollback);
+static void consolehckScrollbackWrite(consolehckScrollback* scrollback, char const* c, unsigned int const num);
+static void consolehckScrollbackIndex(consolehckScrollback* scrollback, char const* c, unsigned int const num);
+static void consolehckScrollbackSearchAdd(consolehckScrollback* scrollback, unsigned int const line);
+static int consolehckScrollbackLineFind(consolehckScrollback* scrollback, unsigned int const line, char const* query, unsigned int const length, unsigned int const from);
+static int consolehckScrollbackCandidates(consolehckScrollback const* scrollback, char const* query, unsigned int const length, unsigned int const** blocks, unsigned int* numBlocks);
+static void consolehckScrollbackPushText(consolehckScrollback* scrollback, char const* c, unsigned int const length);
+static void consolehckScrollbackPushEscaped(consolehckScrollback* scrollback, char const* c, unsigned int const length);
+static void consolehckScrollbackIndexFormatted(consolehckScrollback* scrollback, unsigned int const end, unsigned int const length);
+static void consolehckScrollbackMark(consolehckScrollback* scrollback);
+static void consolehckScrollbackDropSpans(consolehckScrollback* scrollback);
+static int consolehckStyleEqual(consolehckStyle const* a, consolehckStyle const* b);
+
+static consolehckStyle const DEFAULT_STYLE = {{0, 0, 0, 0}, {0, 0, 0, 0}, 0};
+
+consolehckScrollback* consolehckScrollbackNew(unsigned int const initialSize)
+{
+  consolehckScrollback* const scrollback = calloc(1, sizeof(consolehckScrollback));
+  scrollback->bufferSize = initialSize > 0 ? initialSize : 1;
+  scrollback->data = calloc(scrollback->bufferSize, sizeof(char));
+  scrollback->start = 0;
+  scrollback->length = 0;
+  scrollback->linesSize = 16;
+  scrollback->lines = calloc(scrollback->linesSize, sizeof(consolehckLine));
+  scrollback->firstLine = 0;
+  scrollback->numLines = 0;
+  scrollback->maxLines = 0;
+  scrollback->maxSize = 0;
+  scrollback->layoutKey = 1;
+  scrollback->rowsKey = 0;
+  scrollback->rowsFirstId = 0;
+  scrollback->rowsEndId = 0;
+  scrollback->firstLineId = 0;
+  scrollback->searchIndex = NULL;
+  scrollback->searchFirstBlock = 0;
+  scrollback->lineScratch = NULL;
+  scrollback->lineScratchSize = 0;
+  scrollback->startId = 0;
+  scrollback->spans = NULL;
+  scrollback->spansSize = 0;
+  scrollback->firstSpan = 0;
+  scrollback->numSpans = 0;
+  scrollback->style = DEFAULT_STYLE;
+  scrollback->escapeLength = 0;
+
+  return scrollback;
+}
+
+void consolehckScrollbackFree(consolehckScrollback* scrollback)
+{
+  consolehckScrollbackClear(scrollback);
+  consolehckScrollbackSearchIndex(scrollback, 0);
+  free(scrollback->lineScratch);
+  free(scrollback->spans);
+  free(scrollback->data);
+  free(scrollback->lines);
+  scrollback->data = NULL;
+  scrollback->lines = NULL;
+  scrollback->bufferSize = 0;
+  scrollback->length = 0;
+  free(scrollback);
+}
+
+void consolehckScrollbackLimit(consolehckScrollback* scrollback, unsigned int const maxLines, unsigned int const maxSize)
+{
+  scrollback->maxLines = maxLines;
+  scrollback->maxSize = maxSize;
+
+  unsigned int const maxBufferSize = maxSize;
+  if(maxBufferSize > 0 && scrollback->bufferSize > maxBufferSize)
+  {
+    // Drop history that no longer fits, then shrink the ring to the new cap
+    while(scrollback->length > maxBufferSize && scrollback->numLines > 0)
+    {
+      consolehckScrollbackDropLine(scrollback);
+    }
+    if(scrollback->length > maxBufferSize)
+    {
+      consolehckScrollbackDropChars(scrollback, scrollback->length - maxBufferSize);
+    }
+    consolehckScrollbackResize(scrollback, maxBufferSize);
+  }
+
+  consolehckScrollbackEnforceLineLimit(scrollback);
+}
+
+void consolehckScrollbackClear(consolehckScrollback* scrollback)
+{
+  unsigned int i;
+  for(i = 0; i <= scrollback->numLines; ++i)
+  {
+    free(scrollback->lines[(scrollback->firstLine + i) % scrollback->linesSize].rowStarts);
+  }
+
+  scrollback->start = 0;
+  scrollback->length = 0;
+  scrollback->firstLine = 0;
+  scrollback->numLines = 0;
+  memset(scrollback->lines, 0, scrollback->linesSize * sizeof(consolehckLine));
+
+  scrollback->firstLineId = 0;
+  scrollback->rowsKey = 0;
+  scrollback->searchFirstBlock = 0;
+  if(scrollback->searchIndex != NULL)
+  {
+    consolehckTrigramIndexClear(scrollback->searchIndex);
+  }
+
+  // Text pushed after clearing keeps the current style
+  scrollback->startId = 0;
+  scrollback->firstSpan = 0;
+  scrollback->numSpans = 0;
+  consolehckScrollbackMark(scrollback);
+}
+
+char consolehckScrollbackGet(consolehckScrollback const* scrollback, unsigned int const index)
+{
+  if(index >= scrollback->length)
+    return 0;
+
+  return scrollback->data[(scrollback->start + index) % scrollback->bufferSize];
+}
+
+void consolehckScrollbackCopy(consolehckScrollback const* scrollback, unsigned int const index, unsigned int const num, char* result)
+{
+  // Copy out in at most two segments, the second one starting from the beginning of the ring
+  unsigned int const first = (scrollback->start + index) % scrollback->bufferSize;
+  unsigned int const firstLength = scrollback->bufferSize - first < num ? scrollback->bufferSize - first : num;
+  memcpy(result, scrollback->data + first, firstLength);
+  memcpy(result + firstLength, scrollback->data, num - firstLength);
+}
+
+unsigned int consolehckScrollbackLineCount(consolehckScrollback const* scrollback)
+{
+  return scrollback->numLines + 1;
+}
+
+consolehckLine* consolehckScrollbackGetLine(consolehckScrollback* scrollback, unsigned int const line)
+{
+  return &scrollback->lines[(scrollback->firstLine + line) % scrollback->linesSize];
+}
+
+void consolehckScrollbackCopyLine(consolehckScrollback const* scrollback, unsigned int const line, char* result)
+{
+  consolehckLine const* const l = &scrollback->lines[(scrollback->firstLine + line) % scrollback->linesSize];
+  unsigned int const index = (l->start + scrollback->bufferSize - scrollback->start) % scrollback->bufferSize;
+  consolehckScrollbackCopy(scrollback, index, l->length, result);
+}
+
+void consolehckScrollbackLayout(consolehckScrollback* scrollback, float const width, unsigned int const fontId, unsigned int const fontSize)
+{
+  if(scrollback->layoutWidth == width && scrollback->layoutFontId == fontId && scrollback->layoutFontSize == fontSize)
+    return;
+
+  scrollback->layoutWidth = width;
+  scrollback->layoutFontId = fontId;
+  scrollback->layoutFontSize = fontSize;
+  consolehckScrollbackInvalidateLayout(scrollback);
+}
+
+void consolehckScrollbackInvalidateLayout(consolehckScrollback* scrollback)
+{
+  // Lines lay out again lazily when their key no longer matches, 0 is never a valid key
+  scrollback->layoutKey += 1;
+  if(scrollback->layoutKey == 0)
+  {
+    scrollback->layoutKey = 1;
+  }
+}
+
+void consolehckScrollbackPushChar(consolehckScrollback* scrollback, char const c)
+{
+  if(c == '\x1b' || scrollback->escapeLength > 0)
+  {
+    consolehckScrollbackPushEscaped(scrollback, &c, 1);
+    return;
+  }
+
+  consolehckScrollbackReserve(scrollback, 1);
+  consolehckScrollbackWrite(scrollback, &c, 1);
+  consolehckScrollbackEnforceLineLimit(scrollback);
+}
+
+void consolehckScrollbackPushUnicodeChar(consolehckScrollback* scrollback, unsigned int const c)
+{
+  char encoded[4];
+  consolehckScrollbackPushStringN(scrollback, encoded, utf8Encode(c, encoded, sizeof(encoded)));
+}
+
+void consolehckScrollbackPushString(consolehckScrollback* scrollback, char const* c)
+{
+  consolehckScrollbackPushStringN(scrollback, c, strlen(c));
+}
+
+void consolehckScrollbackPushStringN(consolehckScrollback* scrollback, char const* c, unsigned int const length)
+{
+  // Text without escapes is pushed as is, only a cheap scan for ESC stands in its way
+  if(scrollback->escapeLength > 0 || memchr(c, '\x1b', length) != NULL)
+  {
+    consolehckScrollbackPushEscaped(scrollback, c, length);
+  }
+  else
+  {
+    consolehckScrollbackPushText(scrollback, c, length);
+  }
+}
+
+void consolehckScrollbackPushUnicodeString(consolehckScrollback* scrollback, unsigned int const* c)
+{
+  consolehckScrollbackPushUnicodeStringN(scrollback, c, unicodeStringLength(c));
+}
+
+void consolehckScrollbackPushUnicodeStringN(consolehckScrollback* scrollback, unsigned int const* c, unsigned int num)
+{
+  unsigned int const maxBufferSize = scrollback->maxSize;
+  unsigned int length = utf8EncodedStringLengthN(c, num);
+
+  // Escapes are parsed from UTF-8, strings carrying one are encoded up front
+  unsigned int i = 0;
+  while(i < num && c[i] != 0x1b)
+    ++i;
+  if(i < num || scrollback->escapeLength > 0)
+  {
+    char buffer[512];
+    char* const encoded = length <= sizeof(buffer) ? buffer : malloc(length);
+    utf8EncodeStringN(c, num, encoded);
+    consolehckScrollbackPushEscaped(scrollback, encoded, length);
+    if(encoded != buffer)
+    {
+      free(encoded);
+    }
+    return;
+  }
+
+  // Only the tail of a string larger than the whole ring can be kept
+  while(maxBufferSize > 0 && length > maxBufferSize)
+  {
+    length -= utf8EncodedLength(*c);
+    ++c;
+    --num;
+  }
+
+  consolehckScrollbackReserve(scrollback, length);
+
+  unsigned int const end = (scrollback->start + scrollback->length) % scrollback->bufferSize;
+  if(scrollback->bufferSize - end >= length)
+  {
+    // Encode straight into the ring when the free space after the end is contiguous
+    utf8EncodeStringN(c, num, scrollback->data + end);
+    consolehckScrollbackIndex(scrollback, scrollback->data + end, length);
+  }
+  else
+  {
+    for(i = 0; i < num; ++i)
+    {
+      char encoded[4];
+      consolehckScrollbackWrite(scrollback, encoded, utf8Encode(c[i], encoded, sizeof(encoded)));
+    }
+  }
+
+  consolehckScrollbackEnforceLineLimit(scrollback);
+}
+
+void consolehckScrollbackPushFormatV(consolehckScrollback* scrollback, char const* format, va_list args)
+{
+  /* Format straight into the free space after the end of the text and index it in place.
+   * Output that doesn't fit there is measured by the first attempt, room is reserved for it and it is
+   * formatted again. Only when the reserved room wraps around the end of the ring, or the output is
+   * larger than the whole ring, does it go through a stack buffer, or the heap if it is larger than that.
+   */
+  va_list retry;
+  va_copy(retry, args);
+
+  unsigned int end = (scrollback->start + scrollback->length) % scrollback->bufferSize;
+  unsigned int contiguous = scrollback->bufferSize - end < scrollback->bufferSize - scrollback->length ? scrollback->bufferSize - end : scrollback->bufferSize - scrollback->length;
+  int const length = vsnprintf(scrollback->data + end, contiguous, format, args);
+
+  if(length < 0)
+  {
+    va_end(retry);
+    return;
+  }
+
+  if((unsigned int) length < contiguous)
+  {
+    consolehckScrollbackIndexFormatted(scrollback, end, length);
+  }
+  else
+  {
+    if(scrollback->maxSize == 0 || (unsigned int) length <= scrollback->maxSize)
+    {
+      consolehckScrollbackReserve(scrollback, length);
+      end = (scrollback->start + scrollback->length) % scrollback->bufferSize;
+      contiguous = scrollback->bufferSize - end < scrollback->bufferSize - scrollback->length ? scrollback->bufferSize - end : scrollback->bufferSize - scrollback->length;
+    }
+
+    if((unsigned int) length < contiguous)
+    {
+      vsnprintf(scrollback->data + end, contiguous, format, retry);
+      consolehckScrollbackIndexFormatted(scrollback, end, length);
+    }
+    else
+    {
+      char buffer[512];
+      char* const formatted = (unsigned int) length < sizeof(buffer) ? buffer : malloc(length + 1);
+      vsnprintf(formatted, length + 1, format, retry);
+      consolehckScrollbackPushStringN(scrollback, formatted, length);
+      if(formatted != buffer)
+      {
+        free(formatted);
+      }
+    }
+  }
+
+  va_end(retry);
+  consolehckScrollbackEnforceLineLimit(scrollback);
+}
+
+void consolehckScrollbackStyle(consolehckScrollback* scrollback, consolehckStyle const* style)
+{
+  // Unset colors are cleared so equal looking styles compare equal
+  scrollback->style = *style;
+  if(!(style->attributes & CONSOLEHCK_ATTRIBUTE_FOREGROUND))
+  {
+    scrollback->style.foreground = DEFAULT_STYLE.foreground;
+  }
+  if(!(style->attributes & CONSOLEHCK_ATTRIBUTE_BACKGROUND))
+  {
+    scrollback->style.background = DEFAULT_STYLE.background;
+  }
+  consolehckScrollbackMark(scrollback);
+}
+
+consolehckStyle const* consolehckScrollbackStyleAt(consolehckScrollback const* scrollback, unsigned int const index, unsigned int* end)
+{
+  // Binary search for the number of spans starting at or before index, the last of them covers it
+  consolehckSpan const* const spans = scrollback->spans + scrollback->firstSpan;
+  unsigned int low = 0;
+  unsigned int high = scrollback->numSpans;
+  while(low < high)
+  {
+    unsigned int const middle = low + (high - low) / 2;
+    if((int) (spans[middle].start - scrollback->startId - index) <= 0)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  *end = low < scrollback->numSpans ? spans[low].start - scrollback->startId : scrollback->length;
+  if(low == 0 || consolehckStyleEqual(&spans[low - 1].style, &DEFAULT_STYLE))
+    return NULL;
+
+  return &spans[low - 1].style;
+}
+
+void consolehckScrollbackSearchIndex(consolehckScrollback* scrollback, int const enabled)
+{
+  // Enabling indexes the complete lines already in the scrollback, later ones are added as they are closed
+  if(!enabled)
+  {
+    if(scrollback->searchIndex != NULL)
+    {
+      consolehckTrigramIndexFree(scrollback->searchIndex);
+      scrollback->searchIndex = NULL;
+    }
+    return;
+  }
+
+  if(scrollback->searchIndex != NULL)
+    return;
+
+  scrollback->searchIndex = consolehckTrigramIndexNew();
+  scrollback->searchFirstBlock = scrollback->firstLineId / CONSOLEHCK_SEARCH_BLOCK_LINES;
+
+  unsigned int i;
+  for(i = 0; i < scrollback->numLines; ++i)
+  {
+    consolehckScrollbackSearchAdd(scrollback, i);
+  }
+}
+
+int consolehckScrollbackFindPrevious(consolehckScrollback* scrollback, char const* query, unsigned int const length, unsigned int const line, unsigned int const start, consolehckMatch* match)
+{
+  /* Newest match starting before byte start of line. The open last line is not indexed and always checked,
+   * complete lines only when their block is posted under the query's rarest trigram.
+   * Within a line the last match before the limit wins.
+   */
+  if(length == 0)
+    return 0;
+
+  unsigned int const* blocks = NULL;
+  unsigned int numBlocks = 0;
+  int const indexed = consolehckScrollbackCandidates(scrollback, query, length, &blocks, &numBlocks);
+  unsigned int const lastLine = line < scrollback->numLines ? line : scrollback->numLines;
+  unsigned int block = numBlocks;
+
+  if(indexed)
+  {
+    // First posting past the block of lastLine
+    unsigned int const lastBlock = (scrollback->firstLineId + lastLine) / CONSOLEHCK_SEARCH_BLOCK_LINES;
+    unsigned int low = 0;
+    unsigned int high = numBlocks;
+    while(low < high)
+    {
+      unsigned int const middle = low + (high - low) / 2;
+      if(blocks[middle] <= lastBlock)
+        low = middle + 1;
+      else
+        high = middle;
+    }
+    block = low;
+  }
+
+  unsigned int current = lastLine + 1;
+  while(current > 0)
+  {
+    --current;
+
+    // Jump to the last line of the next candidate block below
+    if(indexed && current < scrollback->numLines)
+    {
+      unsigned int const id = scrollback->firstLineId + current;
+      while(block > 0 && blocks[block - 1] * CONSOLEHCK_SEARCH_BLOCK_LINES > id)
+        --block;
+      if(block == 0 || blocks[block - 1] < scrollback->searchFirstBlock)
+        return 0;
+
+      unsigned int const blockEnd = (blocks[block - 1] + 1) * CONSOLEHCK_SEARCH_BLOCK_LINES;
+      if(blockEnd <= id)
+      {
+        if(blockEnd <= scrollback->firstLineId)
+          return 0;
+        current = blockEnd - 1 - scrollback->firstLineId;
+      }
+    }
+
+    int found = -1;
+    int next = consolehckScrollbackLineFind(scrollback, current, query, length, 0);
+    while(next >= 0 && (current < line || (unsigned int) next < start))
+    {
+      found = next;
+      next = consolehckScrollbackLineFind(scrollback, current, query, length, next + 1);
+    }
+
+    if(found >= 0)
+    {
+      match->line = current;
+      match->start = found;
+      match->length = length;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int consolehckScrollbackFindNext(consolehckScrollback* scrollback, char const* query, unsigned int const length, unsigned int const line, unsigned int const start, consolehckMatch* match)
+{
+  // Oldest match starting at or after byte start of line, the mirror image of consolehckScrollbackFindPrevious
+  if(length == 0 || line > scrollback->numLines)
+    return 0;
+
+  unsigned int const* blocks = NULL;
+  unsigned int numBlocks = 0;
+  int const indexed = consolehckScrollbackCandidates(scrollback, query, length, &blocks, &numBlocks);
+  unsigned int block = 0;
+
+  if(indexed)
+  {
+    // First posting at or after the block of line
+    unsigned int const firstBlock = (scrollback->firstLineId + line) / CONSOLEHCK_SEARCH_BLOCK_LINES;
+    unsigned int high = numBlocks;
+    while(block < high)
+    {
+      unsigned int const middle = block + (high - block) / 2;
+      if(blocks[middle] < firstBlock)
+        block = middle + 1;
+      else
+        high = middle;
+    }
+  }
+
+  unsigned int current;
+  for(current = line; current <= scrollback->numLines; ++current)
+  {
+    // Jump to the first line of the next candidate block, after the last one only the open line is left
+    if(indexed && current < scrollback->numLines)
+    {
+      unsigned int const id = scrollback->firstLineId + current;
+      while(block < numBlocks && (blocks[block] + 1) * CONSOLEHCK_SEARCH_BLOCK_LINES <= id)
+        ++block;
+
+      if(block == numBlocks)
+      {
+        current = scrollback->numLines;
+      }
+      else if(blocks[block] * CONSOLEHCK_SEARCH_BLOCK_LINES > id)
+      {
+        unsigned int const blockStart = blocks[block] * CONSOLEHCK_SEARCH_BLOCK_LINES - scrollback->firstLineId;
+        current = blockStart < scrollback->numLines ? blockStart : scrollback->numLines;
+      }
+    }
+
+    int const found = consolehckScrollbackLineFind(scrollback, current, query, length, current == line ? start : 0);
+    if(found >= 0)
+    {
+      match->line = current;
+      match->start = found;
+      match->length = length;
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+unsigned int consolehckScrollbackFindAll(consolehckScrollback* scrollback, char const* query, unsigned int const length, consolehckMatch* matches, unsigned int const maxMatches)
+{
+  // Non-overlapping matches from the oldest on, returns how many there are of which the first maxMatches are stored
+  unsigned int num = 0;
+  consolehckMatch match;
+  int found = consolehckScrollbackFindNext(scrollback, query, length, 0, 0, &match);
+  while(found)
+  {
+    if(num < maxMatches)
+    {
+      matches[num] = match;
+    }
+    ++num;
+    found = consolehckScrollbackFindNext(scrollback, query, length, match.line, match.start + length, &match);
+  }
+
+  return num;
+}
+
+char const* consolehckScrollbackLineText(consolehckScrollback* scrollback, unsigned int const line)
+{
+  // Lines are read in place when the byte after them ends any truncated sequence, which the newline of a
+  // complete line does, and copied to the zero-terminated scratch line otherwise
+  consolehckLine const* const l = &scrollback->lines[(scrollback->firstLine + line) % scrollback->linesSize];
+  unsigned int const end = l->start + l->length;
+  if(end < scrollback->bufferSize && (scrollback->data[end] & 0xC0) != 0x80)
+    return scrollback->data + l->start;
+
+  if(scrollback->lineScratchSize < l->length + 1)
+  {
+    scrollback->lineScratchSize = l->length + 1;
+    free(scrollback->lineScratch);
+    scrollback->lineScratch = malloc(scrollback->lineScratchSize);
+  }
+  consolehckScrollbackCopyLine(scrollback, line, scrollback->lineScratch);
+  scrollback->lineScratch[l->length] = '\0';
+
+  return scrollback->lineScratch;
+}
+
+void consolehckScrollbackMemory(consolehckScrollback const* scrollback, consolehckMemory* memory)
+{
+  // Without the search index, see consolehckTrigramIndexMemory. Cached wrap points count as used.
+  memory->used += sizeof(consolehckScrollback) + scrollback->length;
+  memory->used += (scrollback->numLines + 1) * sizeof(consolehckLine) + scrollback->numSpans * sizeof(consolehckSpan);
+  memory->reserved += sizeof(consolehckScrollback) + scrollback->bufferSize + scrollback->lineScratchSize;
+  memory->reserved += scrollback->linesSize * sizeof(consolehckLine) + scrollback->spansSize * sizeof(consolehckSpan);
+
+  unsigned int i;
+  for(i = 0; i <= scrollback->numLines; ++i)
+  {
+    consolehckLine const* const line = &scrollback->lines[(scrollback->firstLine + i) % scrollback->linesSize];
+    if(line->rowStarts != NULL)
+    {
+      memory->used += line->numRows * sizeof(unsigned int);
+      memory->reserved += line->numRows * sizeof(unsigned int);
+    }
+  }
+}
+
+void consolehckScrollbackTrim(consolehckScrollback* scrollback)
+{
+  // The scratch line is allocated again when a search or layout needs it
+  free(scrollback->lineScratch);
+  scrollback->lineScratch = NULL;
+  scrollback->lineScratchSize = 0;
+
+  // The ring, the line records and the spans shrink to their contents and grow back by doubling
+  unsigned int const bufferSize = scrollback->length > 0 ? scrollback->length : 1;
+  if(scrollback->bufferSize > bufferSize)
+  {
+    consolehckScrollbackResize(scrollback, bufferSize);
+  }
+
+  if(scrollback->linesSize > scrollback->numLines + 1)
+  {
+    consolehckScrollbackResizeLines(scrollback, scrollback->numLines + 1);
+  }
+
+  if(scrollback->spansSize > scrollback->numSpans)
+  {
+    memmove(scrollback->spans, scrollback->spans + scrollback->firstSpan, scrollback->numSpans * sizeof(consolehckSpan));
+    scrollback->firstSpan = 0;
+    scrollback->spansSize = scrollback->numSpans;
+    if(scrollback->spansSize > 0)
+    {
+      scrollback->spans = realloc(scrollback->spans, scrollback->spansSize * sizeof(consolehckSpan));
+    }
+    else
+    {
+      free(scrollback->spans);
+      scrollback->spans = NULL;
+    }
+  }
+
+  // Prune every dropped block before shrinking the postings lists, not only once they outnumber the live ones
+  if(scrollback->searchIndex != NULL)
+  {
+    unsigned int const firstBlock = scrollback->firstLineId / CONSOLEHCK_SEARCH_BLOCK_LINES;
+    if(firstBlock != scrollback->searchFirstBlock)
+    {
+      consolehckTrigramIndexPrune(scrollback->searchIndex, firstBlock);
+      scrollback->searchFirstBlock = firstBlock;
+    }
+
+    consolehckTrigramIndexTrim(scrollback->searchIndex);
+  }
+}
+
+static void consolehckScrollbackResize(consolehckScrollback* scrollback, unsigned int const newSize)
+{
+  char* const newData = calloc(newSize, sizeof(char));
+  consolehckScrollbackCopy(scrollback, 0, scrollback->length, newData);
+
+  // Line starts are physical ring positions, rebase them onto the unwrapped data
+  unsigned int i;
+  for(i = 0; i < scrollback->numLines; ++i)
+  {
+    consolehckLine* const line = &scrollback->lines[(scrollback->firstLine + i) % scrollback->linesSize];
+    line->start = (line->start + scrollback->bufferSize - scrollback->start) % scrollback->bufferSize;
+  }
+
+  // The open line may start right at the end of a full ring, place it by its length instead
+  consolehckLine* const openLine = &scrollback->lines[(scrollback->firstLine + scrollback->numLines) % scrollback->linesSize];
+  openLine->start = scrollback->length - openLine->length;
+
+  free(scrollback->data);
+  scrollback->data = newData;
+  scrollback->bufferSize = newSize;
+  scrollback->start = 0;
+}
+
+static void consolehckScrollbackResizeLines(consolehckScrollback* scrollback, unsigned int const newSize)
+{
+  consolehckLine* const newLines = calloc(newSize, sizeof(consolehckLine));
+
+  unsigned int i;
+  for(i = 0; i <= scrollback->numLines; ++i)
+  {
+    newLines[i] = scrollback->lines[(scrollback->firstLine + i) % scrollback->linesSize];
+  }
+
+  free(scrollback->lines);
+  scrollback->lines = newLines;
+  scrollback->linesSize = newSize;
+  scrollback->firstLine = 0;
+}
+
+static void consolehckScrollbackNewLine(consolehckScrollback* scrollback)
+{
+  // Close the open line and start a new, empty one after the newline
+  if(scrollback->searchIndex != NULL)
+  {
+    consolehckScrollbackSearchAdd(scrollback, scrollback->numLines);
+  }
+
+  if(scrollback->numLines + 2 > scrollback->linesSize)
+  {
+    consolehckScrollbackResizeLines(scrollback, scrollback->linesSize * 2);
+  }
+
+  scrollback->numLines += 1;
+  consolehckLine* const line = &scrollback->lines[(scrollback->firstLine + scrollback->numLines) % scrollback->linesSize];
+  line->start = (scrollback->start + scrollback->length) % scrollback->bufferSize;
+  line->length = 0;
+  line->layoutKey = 0;
+  line->numRows = 0;
+  line->rowStarts = NULL;
+  line->rowsAbove = 0;
+}
+
+static void consolehckScrollbackDropLine(consolehckScrollback* scrollback)
+{
+  consolehckLine* const line = &scrollback->lines[scrollback->firstLine];
+  unsigned int const dropped = line->length + 1;
+  free(line->rowStarts);
+  line->rowStarts = NULL;
+
+  scrollback->start = (scrollback->start + dropped) % scrollback->bufferSize;
+  scrollback->length -= dropped;
+  scrollback->firstLine = (scrollback->firstLine + 1) % scrollback->linesSize;
+  scrollback->numLines -= 1;
+  scrollback->firstLineId += 1;
+  scrollback->startId += dropped;
+  consolehckScrollbackDropSpans(scrollback);
+
+  // Postings of dropped blocks are skipped by searches, prune them once they outnumber the live ones
+  if(scrollback->searchIndex != NULL)
+  {
+    unsigned int const firstBlock = scrollback->firstLineId / CONSOLEHCK_SEARCH_BLOCK_LINES;
+    unsigned int const deadBlocks = firstBlock - scrollback->searchFirstBlock;
+    unsigned int const liveBlocks = (scrollback->firstLineId + scrollback->numLines) / CONSOLEHCK_SEARCH_BLOCK_LINES - firstBlock + 1;
+    if(deadBlocks >= 64 && deadBlocks > liveBlocks)
+    {
+      consolehckTrigramIndexPrune(scrollback->searchIndex, firstBlock);
+      scrollback->searchFirstBlock = firstBlock;
+    }
+  }
+}
+
+static void consolehckScrollbackDropChars(consolehckScrollback* scrollback, unsigned int const num)
+{
+  // Only valid while the open line is the only line, drops at least num bytes up to the next character
+  consolehckLine* const line = &scrollback->lines[scrollback->firstLine];
+  unsigned int dropped = num;
+  while(dropped < line->length && (consolehckScrollbackGet(scrollback, dropped) & 0xC0) == 0x80)
+  {
+    ++dropped;
+  }
+
+  scrollback->start = (scrollback->start + dropped) % scrollback->bufferSize;
+  scrollback->length -= dropped;
+  line->start = scrollback->start;
+  line->length -= dropped;
+  line->layoutKey = 0;
+  scrollback->startId += dropped;
+  consolehckScrollbackDropSpans(scrollback);
+}
+
+static void consolehckScrollbackReserve(consolehckScrollback* scrollback, unsigned int const num)
+{
+  if(scrollback->length + num <= scrollback->bufferSize)
+    return;
+
+  unsigned int const maxBufferSize = scrollback->maxSize;
+  if(maxBufferSize == 0 || scrollback->bufferSize < maxBufferSize)
+  {
+    unsigned int newSize = scrollback->bufferSize;
+    while(newSize < scrollback->length + num)
+    {
+      newSize *= 2;
+    }
+    if(maxBufferSize > 0 && newSize > maxBufferSize)
+    {
+      newSize = maxBufferSize;
+    }
+    consolehckScrollbackResize(scrollback, newSize);
+  }
+
+  // The ring is at its cap, make room by dropping the oldest lines
+  while(scrollback->length + num > scrollback->bufferSize && scrollback->numLines > 0)
+  {
+    consolehckScrollbackDropLine(scrollback);
+  }
+
+  if(scrollback->length + num > scrollback->bufferSize)
+  {
+    // A single unterminated line fills the ring, drop its oldest characters
+    consolehckScrollbackDropChars(scrollback, scrollback->length + num - scrollback->bufferSize);
+  }
+}
+
+static void consolehckScrollbackWrite(consolehckScrollback* scrollback, char const* c, unsigned int const num)
+{
+  // Copy num reserved bytes after the end of the text in at most two segments and index them
+  unsigned int const end = (scrollback->start + scrollback->length) % scrollback->bufferSize;
+  unsigned int const firstLength = scrollback->bufferSize - end < num ? scrollback->bufferSize - end : num;
+  memcpy(scrollback->data + end, c, firstLength);
+  memcpy(scrollback->data, c + firstLength, num - firstLength);
+  consolehckScrollbackIndex(scrollback, c, num);
+}
+
+static void consolehckScrollbackIndex(consolehckScrollback* scrollback, char const* c, unsigned int const num)
+{
+  // Account for num bytes just written after the end of the text, a run up to the next newline at a time
+  unsigned int i = 0;
+  while(i < num)
+  {
+    char const* const newline = memchr(c + i, '\n', num - i);
+    unsigned int const run = newline != NULL ? (unsigned int) (newline - (c + i)) : num - i;
+
+    if(run > 0)
+    {
+      consolehckLine* const line = &scrollback->lines[(scrollback->firstLine + scrollback->numLines) % scrollback->linesSize];
+      line->length += run;
+      line->layoutKey = 0;
+      scrollback->length += run;
+      i += run;
+    }
+
+    if(newline != NULL)
+    {
+      scrollback->length += 1;
+      consolehckScrollbackNewLine(scrollback);
+      i += 1;
+    }
+  }
+}
+
+static void consolehckScrollbackEnforceLineLimit(consolehckScrollback* scrollback)
+{
+  if(scrollback->maxLines == 0)
+    return;
+
+  while(scrollback->numLines > scrollback->maxLines)
+  {
+    consolehckScrollbackDropLine(scrollback);
+  }
+}
+
+static void consolehckScrollbackSearchAdd(consolehckScrollback* scrollback, unsigned int const line)
+{
+  // Post the trigrams of a complete line under its block. A line wrapping around the end of the ring
+  // is posted as its two segments plus the trigrams spanning the seam between them.
+  consolehckLine const* const l = &scrollback->lines[(scrollback->firstLine + line) % scrollback->linesSize];
+  unsigned int const block = (scrollback->firstLineId + line) / CONSOLEHCK_SEARCH_BLOCK_LINES;
+  unsigned int const first = scrollback->bufferSize - l->start < l->length ? scrollback->bufferSize - l->start : l->length;
+  consolehckTrigramIndexAdd(scrollback->searchIndex, block, scrollback->data + l->start, first);
+
+  if(first < l->length)
+  {
+    unsigned int const second = l->length - first;
+    consolehckTrigramIndexAdd(scrollback->searchIndex, block, scrollback->data, second);
+
+    char seam[4];
+    unsigned int const before = first < 2 ? first : 2;
+    unsigned int const after = second < 2 ? second : 2;
+    memcpy(seam, scrollback->data + l->start + first - before, before);
+    memcpy(seam + before, scrollback->data, after);
+    consolehckTrigramIndexAdd(scrollback->searchIndex, block, seam, before + after);
+  }
+}
+
+static int consolehckScrollbackLineFind(consolehckScrollback* scrollback, unsigned int const line, char const* query, unsigned int const length, unsigned int const from)
+{
+  // Byte offset of the first match in line starting at or after from, -1 if there is none
+  unsigned int const lineLength = scrollback->lines[(scrollback->firstLine + line) % scrollback->linesSize].length;
+  if(length > lineLength || from > lineLength - length)
+    return -1;
+
+  char const* const text = consolehckScrollbackLineText(scrollback, line);
+  unsigned int const last = lineLength - length;
+  unsigned int i = from;
+  while(i <= last)
+  {
+    char const* const candidate = memchr(text + i, query[0], last - i + 1);
+    if(candidate == NULL)
+      return -1;
+
+    i = candidate - text;
+    if(memcmp(candidate, query, length) == 0)
+      return i;
+    ++i;
+  }
+
+  return -1;
+}
+
+static int consolehckScrollbackCandidates(consolehckScrollback const* scrollback, char const* query, unsigned int const length, unsigned int const** blocks, unsigned int* numBlocks)
+{
+  // Blocks that may hold matches, 0 when every line has to be searched
+  if(scrollback->searchIndex == NULL)
+    return 0;
+
+  return consolehckTrigramIndexRarest(scrollback->searchIndex, query, length, blocks, numBlocks);
+}
+
+static void consolehckScrollbackPushText(consolehckScrollback* scrollback, char const* c, unsigned int const length)
+{
+  unsigned int const maxBufferSize = scrollback->maxSize;
+  unsigned int num = length;
+
+  // Only the tail of a string larger than the whole ring can be kept, cut it at a character boundary
+  if(maxBufferSize > 0 && num > maxBufferSize)
+  {
+    c += num - maxBufferSize;
+    num = maxBufferSize;
+    while(num > 0 && (*c & 0xC0) == 0x80)
+    {
+      ++c;
+      --num;
+    }
+  }
+
+  consolehckScrollbackReserve(scrollback, num);
+  consolehckScrollbackWrite(scrollback, c, num);
+  consolehckScrollbackEnforceLineLimit(scrollback);
+}
+
+static void consolehckScrollbackPushEscaped(consolehckScrollback* scrollback, char const* c, unsigned int const length)
+{
+  /* Text between escape sequences is pushed as is. SGR sequences (ESC [ parameters m) change the style of
+   * the text after them, other sequences are dropped: control sequences through their final byte, escapes
+   * with intermediate bytes (ESC ( B) through theirs and OSC, DCS, PM and APC strings through BEL or ESC \.
+   * A sequence cut off by the end of the push is kept in escape, by its ESC, the byte telling its kind and the
+   * parameters of a control sequence, and finished by the next one. Control sequences longer than
+   * CONSOLEHCK_ESCAPE_MAX bytes are dropped whole, strings are skipped at any length.
+   */
+  unsigned int i = 0;
+  while(i < length)
+  {
+    if(scrollback->escapeLength == 0)
+    {
+      char const* const escape = memchr(c + i, '\x1b', length - i);
+      unsigned int const run = escape != NULL ? (unsigned int) (escape - (c + i)) : length - i;
+      if(run > 0)
+      {
+        consolehckScrollbackPushText(scrollback, c + i, run);
+        i += run;
+      }
+
+      if(escape != NULL)
+      {
+        scrollback->escape[0] = '\x1b';
+        scrollback->escapeLength = 1;
+        i += 1;
+      }
+      continue;
+    }
+
+    char const b = c[i++];
+    if(scrollback->escapeLength == 1)
+    {
+      // The byte after ESC tells the kind of sequence, any other byte ends a two byte escape with nothing to show
+      // and another ESC starts over
+      if(b != '\x1b')
+      {
+        scrollback->escape[1] = b;
+        scrollback->escapeLength = (b == '[' || b == ']' || b == 'P' || b == '^' || b == '_' || (b >= 0x20 && b <= 0x2F)) ? 2 : 0;
+      }
+    }
+    else if(scrollback->escape[1] == '[')
+    {
+      if(b >= 0x40 && b <= 0x7E)
+      {
+        // Final byte of a control sequence, parameters are what lies between the bracket and it
+        if(b == 'm' && scrollback->escapeLength < CONSOLEHCK_ESCAPE_MAX)
+        {
+          consolehckAnsiApply(&scrollback->style, scrollback->escape + 2, scrollback->escapeLength - 2);
+          consolehckScrollbackMark(scrollback);
+        }
+        scrollback->escapeLength = 0;
+      }
+      else if(scrollback->escapeLength < CONSOLEHCK_ESCAPE_MAX)
+      {
+        scrollback->escape[scrollback->escapeLength] = b;
+        scrollback->escapeLength += 1;
+      }
+    }
+    else if(scrollback->escape[1] >= 0x20 && scrollback->escape[1] <= 0x2F)
+    {
+      // Intermediate bytes go on until the final one
+      if(b < 0x20 || b > 0x2F)
+      {
+        scrollback->escapeLength = 0;
+      }
+    }
+    else if(scrollback->escapeLength == 3)
+    {
+      // ESC inside a string ends it, anything but the backslash of ST starts the next sequence
+      scrollback->escapeLength = 1;
+      if(b == '\\')
+      {
+        scrollback->escapeLength = 0;
+      }
+      else
+      {
+        --i;
+      }
+    }
+    else if(b == '\a')
+    {
+      scrollback->escapeLength = 0;
+    }
+    else if(b == '\x1b')
+    {
+      scrollback->escapeLength = 3;
+    }
+  }
+}
+
+static void consolehckScrollbackIndexFormatted(consolehckScrollback* scrollback, unsigned int const end, unsigned int const length)
+{
+  // Text formatted into the ring is indexed in place unless it carries escapes, those are parsed from a copy
+  char const* const formatted = scrollback->data + end;
+  if(scrollback->escapeLength == 0 && memchr(formatted, '\x1b', length) == NULL)
+  {
+    consolehckScrollbackIndex(scrollback, formatted, length);
+    return;
+  }
+
+  char buffer[512];
+  char* const copy = length <= sizeof(buffer) ? buffer : malloc(length);
+  memcpy(copy, formatted, length);
+  consolehckScrollbackPushEscaped(scrollback, copy, length);
+  if(copy != buffer)
+  {
+    free(copy);
+  }
+}
+
+static void consolehckScrollbackMark(consolehckScrollback* scrollback)
+{
+  // Start a span in the current style at the end of the text unless the text there already has that style
+  consolehckSpan* const last = scrollback->numSpans > 0 ? &scrollback->spans[scrollback->firstSpan + scrollback->numSpans - 1] : NULL;
+  if(consolehckStyleEqual(last != NULL ? &last->style : &DEFAULT_STYLE, &scrollback->style))
+    return;
+
+  unsigned int const endId = scrollback->startId + scrollback->length;
+  if(last != NULL && last->start == endId)
+  {
+    // Nothing was written in the last style, restyle its span or merge it back into the one before
+    consolehckSpan const* const previous = scrollback->numSpans > 1 ? last - 1 : NULL;
+    if(consolehckStyleEqual(previous != NULL ? &previous->style : &DEFAULT_STYLE, &scrollback->style))
+    {
+      scrollback->numSpans -= 1;
+    }
+    else
+    {
+      last->style = scrollback->style;
+    }
+    return;
+  }
+
+  if(scrollback->firstSpan + scrollback->numSpans == scrollback->spansSize)
+  {
+    if(scrollback->firstSpan > scrollback->numSpans)
+    {
+      memmove(scrollback->spans, scrollback->spans + scrollback->firstSpan, scrollback->numSpans * sizeof(consolehckSpan));
+      scrollback->firstSpan = 0;
+    }
+    else
+    {
+      scrollback->spansSize = scrollback->spansSize > 0 ? scrollback->spansSize * 2 : 16;
+      scrollback->spans = realloc(scrollback->spans, scrollback->spansSize * sizeof(consolehckSpan));
+    }
+  }
+
+  consolehckSpan* const span = &scrollback->spans[scrollback->firstSpan + scrollback->numSpans];
+  span->start = endId;
+  span->style = scrollback->style;
+  scrollback->numSpans += 1;
+}
+
+static void consolehckScrollbackDropSpans(consolehckScrollback* scrollback)
+{
+  // Drop spans that end before the oldest kept byte, and a leading span in the default style as text before the first span has it anyway
+  while(scrollback->numSpans > 0)
+  {
+    consolehckSpan const* const first = &scrollback->spans[scrollback->firstSpan];
+    int const ended = scrollback->numSpans > 1 && (int) (first[1].start - scrollback->startId) <= 0;
+    if(!ended && !consolehckStyleEqual(&first->style, &DEFAULT_STYLE))
+      break;
+
+    scrollback->firstSpan += 1;
+    scrollback->numSpans -= 1;
+  }
+
+  if(scrollback->numSpans == 0)
+  {
+    scrollback->firstSpan = 0;
+  }
+}
+
+static int consolehckStyleEqual(consolehckStyle const* a, consolehckStyle const* b)
+{
+  return a->attributes == b->attributes
+      && a->foreground.r == b->foreground.r && a->foreground.g == b->foreground.g && a->foreground.b == b->foreground.b && a->foreground.a == b->foreground.a
+      && a->background.r == b->background.r && a->background.g == b->background.g && a->background.b == b->background.b && a->background.a == b->background.a;
+}
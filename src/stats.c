@@ -0,0 +1,57 @@
+#include "consolehck.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* Stats are collected only while a console has them enabled, everything instrumented holds a pointer
+ * to the console's stats that is NULL otherwise. Timers read the clock only when that pointer is set,
+ * so a disabled console pays a branch per phase.
+ */
+
+void consolehckStatsReset(consolehckStats* stats)
+{
+  memset(stats, 0, sizeof(consolehckStats));
+}
+
+unsigned long long consolehckStatsClock(void)
+{
+  // Monotonic nanoseconds from an arbitrary start
+#ifdef _WIN32
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (unsigned long long) (counter.QuadPart / frequency.QuadPart) * 1000000000ull
+    + (unsigned long long) (counter.QuadPart % frequency.QuadPart) * 1000000000ull / frequency.QuadPart;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long) now.tv_sec * 1000000000ull + now.tv_nsec;
+#endif
+}
+
+unsigned long long consolehckStatsBegin(consolehckStats const* stats)
+{
+  return stats != NULL ? consolehckStatsClock() : 0;
+}
+
+void consolehckStatsEnd(consolehckStats* stats, consolehckPhase const phase, unsigned long long const begin)
+{
+  if(stats == NULL)
+    return;
+
+  stats->time[phase] += consolehckStatsClock() - begin;
+}
+
+void consolehckStatsAllocated(consolehckStats* stats, unsigned long long const bytes)
+{
+  if(stats == NULL)
+    return;
+
+  stats->bytesAllocated += bytes;
+  stats->allocations += 1;
+}
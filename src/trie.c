@@ -0,0 +1,161 @@
+#include "consolehck.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+/* Nodes live in one growing array and refer to each other by index. Removing a string only clears its
+ * terminal flag and the counts on its path, nodes left with a zero count are skipped when completing
+ * and reused if the string comes back.
+ */
+
+static unsigned int consolehckTrieFind(consolehckTrie const* trie, unsigned int node, unsigned int const* c, unsigned int const length);
+static unsigned int consolehckTrieChild(consolehckTrie* trie, unsigned int const node, unsigned int const codepoint);
+static void consolehckTrieCount(consolehckTrie* trie, unsigned int const* c, unsigned int const length, int const delta);
+static void consolehckTrieCollect(consolehckTrie const* trie, unsigned int const node, consolehckStringBuffer* path, consolehckCompletions* completions);
+
+consolehckTrie* consolehckTrieNew(void)
+{
+  consolehckTrie* const trie = calloc(1, sizeof(consolehckTrie));
+  trie->size = 64;
+  trie->nodes = calloc(trie->size, sizeof(consolehckTrieNode));
+  trie->num = 1;
+
+  return trie;
+}
+
+void consolehckTrieFree(consolehckTrie* trie)
+{
+  free(trie->nodes);
+  free(trie);
+}
+
+void consolehckTrieInsert(consolehckTrie* trie, unsigned int const* c, unsigned int const length)
+{
+  unsigned int node = 0;
+  unsigned int i;
+  for(i = 0; i < length; ++i)
+  {
+    node = consolehckTrieChild(trie, node, c[i]);
+  }
+
+  if(trie->nodes[node].terminal)
+    return;
+
+  trie->nodes[node].terminal = 1;
+  consolehckTrieCount(trie, c, length, 1);
+}
+
+void consolehckTrieRemove(consolehckTrie* trie, unsigned int const* c, unsigned int const length)
+{
+  unsigned int const node = consolehckTrieFind(trie, 0, c, length);
+  if(node == 0 && length > 0)
+    return;
+  if(!trie->nodes[node].terminal)
+    return;
+
+  trie->nodes[node].terminal = 0;
+  consolehckTrieCount(trie, c, length, -1);
+}
+
+unsigned int consolehckTrieComplete(consolehckTrie const* trie, consolehckCompletions* completions)
+{
+  // Walking down the prefix costs its length, collecting visits only subtrees that hold candidates
+  unsigned int const node = consolehckTrieFind(trie, 0, completions->prefix, completions->prefixLength);
+  if(node == 0 && completions->prefixLength > 0)
+    return 0;
+
+  unsigned int const before = completions->count;
+  consolehckStringBuffer* const path = consolehckStringBufferNew(completions->prefixLength + 16);
+  consolehckStringBufferPushUnicodeStringN(path, completions->prefix, completions->prefixLength);
+  consolehckTrieCollect(trie, node, path, completions);
+  consolehckStringBufferFree(path);
+
+  return completions->count - before;
+}
+
+void consolehckTrieMemory(consolehckTrie const* trie, consolehckMemory* memory)
+{
+  memory->used += sizeof(consolehckTrie) + trie->num * sizeof(consolehckTrieNode);
+  memory->reserved += sizeof(consolehckTrie) + trie->size * sizeof(consolehckTrieNode);
+}
+
+static unsigned int consolehckTrieFind(consolehckTrie const* trie, unsigned int node, unsigned int const* c, unsigned int const length)
+{
+  // Node spelling out c below node, 0 if there is none
+  unsigned int i;
+  for(i = 0; i < length; ++i)
+  {
+    node = trie->nodes[node].child;
+    while(node != 0 && trie->nodes[node].codepoint < c[i])
+    {
+      node = trie->nodes[node].sibling;
+    }
+
+    if(node == 0 || trie->nodes[node].codepoint != c[i])
+      return 0;
+  }
+
+  return node;
+}
+
+static unsigned int consolehckTrieChild(consolehckTrie* trie, unsigned int const node, unsigned int const codepoint)
+{
+  // Child of node for codepoint, inserted in sibling order if missing
+  unsigned int previous = 0;
+  unsigned int child = trie->nodes[node].child;
+  while(child != 0 && trie->nodes[child].codepoint < codepoint)
+  {
+    previous = child;
+    child = trie->nodes[child].sibling;
+  }
+
+  if(child != 0 && trie->nodes[child].codepoint == codepoint)
+    return child;
+
+  if(trie->num == trie->size)
+  {
+    trie->size *= 2;
+    trie->nodes = realloc(trie->nodes, trie->size * sizeof(consolehckTrieNode));
+  }
+
+  unsigned int const added = trie->num++;
+  trie->nodes[added] = (consolehckTrieNode) {codepoint, 0, child, 0, 0};
+  if(previous != 0)
+    trie->nodes[previous].sibling = added;
+  else
+    trie->nodes[node].child = added;
+
+  return added;
+}
+
+static void consolehckTrieCount(consolehckTrie* trie, unsigned int const* c, unsigned int const length, int const delta)
+{
+  unsigned int node = 0;
+  unsigned int i;
+  trie->nodes[0].count += delta;
+  for(i = 0; i < length; ++i)
+  {
+    node = consolehckTrieFind(trie, node, c + i, 1);
+    trie->nodes[node].count += delta;
+  }
+}
+
+static void consolehckTrieCollect(consolehckTrie const* trie, unsigned int const node, consolehckStringBuffer* path, consolehckCompletions* completions)
+{
+  if(trie->nodes[node].terminal)
+  {
+    consolehckCompletionsAdd(completions, path->data, path->length);
+  }
+
+  unsigned int child;
+  for(child = trie->nodes[node].child; child != 0; child = trie->nodes[child].sibling)
+  {
+    if(trie->nodes[child].count == 0)
+      continue;
+
+    consolehckStringBufferPushUnicodeChar(path, trie->nodes[child].codepoint);
+    consolehckTrieCollect(trie, child, path, completions);
+    consolehckStringBufferPopUnicodeChar(path);
+  }
+}
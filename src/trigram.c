@@ -0,0 +1,149 @@
+#include "consolehck.h"
+
+#include <stdlib.h>
+#include <memory.h>
+#include <string.h>
+
+/* Postings of ids per hashed byte trigram. Ids must be added in increasing order, so every postings
+ * list is sorted and the newest ids are at its end. Trigrams sharing a bucket share a list, which
+ * only adds candidates: callers verify every candidate against the actual text.
+ */
+
+static unsigned int consolehckTrigramBucket(unsigned char const* c);
+
+consolehckTrigramIndex* consolehckTrigramIndexNew(void)
+{
+  consolehckTrigramIndex* const index = calloc(1, sizeof(consolehckTrigramIndex));
+  index->postings = calloc(CONSOLEHCK_TRIGRAM_BUCKETS, sizeof(unsigned int*));
+  index->lengths = calloc(CONSOLEHCK_TRIGRAM_BUCKETS, sizeof(unsigned int));
+  index->sizes = calloc(CONSOLEHCK_TRIGRAM_BUCKETS, sizeof(unsigned int));
+
+  return index;
+}
+
+void consolehckTrigramIndexFree(consolehckTrigramIndex* index)
+{
+  unsigned int i;
+  for(i = 0; i < CONSOLEHCK_TRIGRAM_BUCKETS; ++i)
+  {
+    free(index->postings[i]);
+  }
+
+  free(index->postings);
+  free(index->lengths);
+  free(index->sizes);
+  free(index);
+}
+
+void consolehckTrigramIndexClear(consolehckTrigramIndex* index)
+{
+  memset(index->lengths, 0, CONSOLEHCK_TRIGRAM_BUCKETS * sizeof(unsigned int));
+}
+
+void consolehckTrigramIndexAdd(consolehckTrigramIndex* index, unsigned int const id, char const* c, unsigned int const length)
+{
+  unsigned int i;
+  for(i = 0; i + 3 <= length; ++i)
+  {
+    unsigned int const bucket = consolehckTrigramBucket((unsigned char const*) c + i);
+    unsigned int const num = index->lengths[bucket];
+
+    // Repeated trigrams of the same id are posted once
+    if(num > 0 && index->postings[bucket][num - 1] == id)
+      continue;
+
+    if(num == index->sizes[bucket])
+    {
+      index->sizes[bucket] = index->sizes[bucket] > 0 ? index->sizes[bucket] * 2 : 4;
+      index->postings[bucket] = realloc(index->postings[bucket], index->sizes[bucket] * sizeof(unsigned int));
+    }
+
+    index->postings[bucket][num] = id;
+    index->lengths[bucket] = num + 1;
+  }
+}
+
+void consolehckTrigramIndexPrune(consolehckTrigramIndex* index, unsigned int const minId)
+{
+  // Drop postings of ids below minId from the front of every list
+  unsigned int i;
+  for(i = 0; i < CONSOLEHCK_TRIGRAM_BUCKETS; ++i)
+  {
+    unsigned int* const postings = index->postings[i];
+    unsigned int const num = index->lengths[i];
+    unsigned int dropped = 0;
+    while(dropped < num && postings[dropped] < minId)
+    {
+      ++dropped;
+    }
+
+    if(dropped > 0)
+    {
+      memmove(postings, postings + dropped, (num - dropped) * sizeof(unsigned int));
+      index->lengths[i] = num - dropped;
+    }
+  }
+}
+
+void consolehckTrigramIndexTrim(consolehckTrigramIndex* index)
+{
+  // Shrink every postings list to its length, lists that were pruned empty are freed
+  unsigned int i;
+  for(i = 0; i < CONSOLEHCK_TRIGRAM_BUCKETS; ++i)
+  {
+    if(index->sizes[i] == index->lengths[i])
+      continue;
+
+    index->sizes[i] = index->lengths[i];
+    if(index->lengths[i] > 0)
+    {
+      index->postings[i] = realloc(index->postings[i], index->lengths[i] * sizeof(unsigned int));
+    }
+    else
+    {
+      free(index->postings[i]);
+      index->postings[i] = NULL;
+    }
+  }
+}
+
+int consolehckTrigramIndexRarest(consolehckTrigramIndex const* index, char const* query, unsigned int const length, unsigned int const** postings, unsigned int* num)
+{
+  // Every match contains all trigrams of the query, so the shortest postings list bounds the candidates
+  if(length < 3)
+    return 0;
+
+  unsigned int i;
+  for(i = 0; i + 3 <= length; ++i)
+  {
+    unsigned int const bucket = consolehckTrigramBucket((unsigned char const*) query + i);
+    if(i == 0 || index->lengths[bucket] < *num)
+    {
+      *postings = index->postings[bucket];
+      *num = index->lengths[bucket];
+    }
+  }
+
+  return 1;
+}
+
+void consolehckTrigramIndexMemory(consolehckTrigramIndex const* index, consolehckMemory* memory)
+{
+  // The bucket arrays are allocated whole, postings lists grow by doubling
+  size_t const buckets = sizeof(consolehckTrigramIndex) + CONSOLEHCK_TRIGRAM_BUCKETS * (sizeof(unsigned int*) + 2 * sizeof(unsigned int));
+  memory->used += buckets;
+  memory->reserved += buckets;
+
+  unsigned int i;
+  for(i = 0; i < CONSOLEHCK_TRIGRAM_BUCKETS; ++i)
+  {
+    memory->used += index->lengths[i] * sizeof(unsigned int);
+    memory->reserved += index->sizes[i] * sizeof(unsigned int);
+  }
+}
+
+static unsigned int consolehckTrigramBucket(unsigned char const* c)
+{
+  unsigned int const trigram = (c[0] << 16) | (c[1] << 8) | c[2];
+  return (trigram * 2654435761u) >> (32 - CONSOLEHCK_TRIGRAM_BUCKET_BITS);
+}
@@ -25,6 +25,12 @@ freely, subject to the following restrictions:
 #include "utf8.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_SIMD_X86
+#include <immintrin.h>
+#endif
 
 /* Internal, should not be called from your code */
 int utf8GetCharLength(const unsigned char *str) {
@@ -211,14 +217,7 @@ unsigned int utf8Decode(unsigned int* state, unsigned int* codep, unsigned int b
 }
 
 int utf8CountCodePoints(unsigned char const* s, int *count) {
-  unsigned int codepoint;
-  unsigned int state = 0;
-
-  for (*count = 0; *s; ++s)
-    if (!utf8Decode(&state, &codepoint, *s))
-      *count += 1;
-
-  return state != UTF8_ACCEPT;
+  return utf8CountCodePointsN(s, strlen((char const*) s), count);
 }
 
 // Added 2013 by Teemu Erkkola, public domain
@@ -231,43 +230,332 @@ int unicodeStringLength(unsigned int const* codepoints)
 
 int utf8EncodedStringLength(unsigned int const* codepoints)
 {
-  unsigned int const* p = codepoints;
-  int encodedLength = 0;
-  while(*p != 0)
+  return utf8EncodedStringLengthN(codepoints, unicodeStringLength(codepoints));
+}
+
+void utf8EncodeString(unsigned int const* codepoints, char* result)
+{
+  utf8EncodeStringN(codepoints, unicodeStringLength(codepoints), result);
+}
+
+void utf8DecodeString(const char *chars, unsigned int* result)
+{
+  utf8DecodeStringN(chars, strlen(chars), result);
+}
+
+// Length-counted variants with SSE2/AVX2 fast paths for runs of ASCII, selected at runtime.
+// Non-ASCII input always goes through the scalar code above, so results are identical.
+
+#define UTF8_SIMD_BLOCK 16
+
+enum { UTF8_SIMD_NONE, UTF8_SIMD_SSE2, UTF8_SIMD_AVX2 };
+
+static int utf8SimdLevel(void)
+{
+  static int level = -1;
+  if(level < 0)
   {
-    encodedLength += utf8EncodedLength(*p);
-    ++p;
+#ifdef UTF8_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+      level = UTF8_SIMD_AVX2;
+    else if(__builtin_cpu_supports("sse2"))
+      level = UTF8_SIMD_SSE2;
+    else
+      level = UTF8_SIMD_NONE;
+#else
+    level = UTF8_SIMD_NONE;
+#endif
   }
+  return level;
+}
 
-  return encodedLength;
+#ifdef UTF8_SIMD_X86
+__attribute__((target("sse2")))
+static unsigned int utf8AsciiPrefixSse2(unsigned char const* s, unsigned int length)
+{
+  unsigned int i = 0;
+  while(length - i >= 16 && _mm_movemask_epi8(_mm_loadu_si128((__m128i const*) (s + i))) == 0)
+    i += 16;
+  return i;
 }
 
-void utf8EncodeString(unsigned int const* codepoints, char* result)
+__attribute__((target("avx2")))
+static unsigned int utf8AsciiPrefixAvx2(unsigned char const* s, unsigned int length)
+{
+  unsigned int i = 0;
+  while(length - i >= 32 && _mm256_movemask_epi8(_mm256_loadu_si256((__m256i const*) (s + i))) == 0)
+    i += 32;
+  return i + utf8AsciiPrefixSse2(s + i, length - i);
+}
+
+__attribute__((target("sse2")))
+static unsigned int utf8DecodeAsciiSse2(unsigned char const* s, unsigned int length, unsigned int* result)
 {
-  unsigned int const* p = codepoints;
+  __m128i const zero = _mm_setzero_si128();
+  unsigned int i = 0;
+  while(length - i >= 16)
+  {
+    __m128i const bytes = _mm_loadu_si128((__m128i const*) (s + i));
+    if(_mm_movemask_epi8(bytes) != 0)
+      break;
+
+    __m128i const lo = _mm_unpacklo_epi8(bytes, zero);
+    __m128i const hi = _mm_unpackhi_epi8(bytes, zero);
+    _mm_storeu_si128((__m128i*) (result + i), _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i*) (result + i + 4), _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128((__m128i*) (result + i + 8), _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128((__m128i*) (result + i + 12), _mm_unpackhi_epi16(hi, zero));
+    i += 16;
+  }
+  return i;
+}
 
-  unsigned int pos = 0;
-  while(*p != 0)
+__attribute__((target("avx2")))
+static unsigned int utf8DecodeAsciiAvx2(unsigned char const* s, unsigned int length, unsigned int* result)
+{
+  unsigned int i = 0;
+  while(length - i >= 32)
   {
-    int len = utf8EncodedLength(*p);
-    utf8Encode(*p, result + pos, len);
-    pos += len;
-    ++p;
+    if(_mm256_movemask_epi8(_mm256_loadu_si256((__m256i const*) (s + i))) != 0)
+      break;
+
+    _mm256_storeu_si256((__m256i*) (result + i), _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*) (s + i))));
+    _mm256_storeu_si256((__m256i*) (result + i + 8), _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*) (s + i + 8))));
+    _mm256_storeu_si256((__m256i*) (result + i + 16), _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*) (s + i + 16))));
+    _mm256_storeu_si256((__m256i*) (result + i + 24), _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*) (s + i + 24))));
+    i += 32;
   }
+  return i + utf8DecodeAsciiSse2(s + i, length - i, result + i);
 }
 
-void utf8DecodeString(const char *chars, unsigned int* result)
+__attribute__((target("sse2")))
+static unsigned int utf8EncodeAsciiSse2(unsigned int const* codepoints, unsigned int num, char* result)
+{
+  __m128i const nonAscii = _mm_set1_epi32(~0x7f);
+  __m128i const zero = _mm_setzero_si128();
+  unsigned int i = 0;
+  while(num - i >= 16)
+  {
+    __m128i const a = _mm_loadu_si128((__m128i const*) (codepoints + i));
+    __m128i const b = _mm_loadu_si128((__m128i const*) (codepoints + i + 4));
+    __m128i const c = _mm_loadu_si128((__m128i const*) (codepoints + i + 8));
+    __m128i const d = _mm_loadu_si128((__m128i const*) (codepoints + i + 12));
+    __m128i const high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), nonAscii);
+    if(_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) != 0xffff)
+      break;
+
+    _mm_storeu_si128((__m128i*) (result + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    i += 16;
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static unsigned int utf8EncodeAsciiAvx2(unsigned int const* codepoints, unsigned int num, char* result)
+{
+  __m256i const nonAscii = _mm256_set1_epi32(~0x7f);
+  __m256i const zero = _mm256_setzero_si256();
+  __m256i const order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  unsigned int i = 0;
+  while(num - i >= 32)
+  {
+    __m256i const a = _mm256_loadu_si256((__m256i const*) (codepoints + i));
+    __m256i const b = _mm256_loadu_si256((__m256i const*) (codepoints + i + 8));
+    __m256i const c = _mm256_loadu_si256((__m256i const*) (codepoints + i + 16));
+    __m256i const d = _mm256_loadu_si256((__m256i const*) (codepoints + i + 24));
+    __m256i const high = _mm256_and_si256(_mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d)), nonAscii);
+    if(_mm256_movemask_epi8(_mm256_cmpeq_epi32(high, zero)) != -1)
+      break;
+
+    // The packs work within 128-bit lanes, put the 4-byte groups back in order afterwards
+    __m256i const packed = _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+    _mm256_storeu_si256((__m256i*) (result + i), _mm256_permutevar8x32_epi32(packed, order));
+    i += 32;
+  }
+  return i + utf8EncodeAsciiSse2(codepoints + i, num - i, result + i);
+}
+
+__attribute__((target("sse2")))
+static unsigned int utf8EncodedLengthSse2(unsigned int const* codepoints, unsigned int num, int* encodedLength)
+{
+  // Each codepoint takes 1 byte plus one for each of the 0x80, 0x800 and 0x10000 limits it reaches.
+  // SSE2 only compares signed integers, so compare with the sign bit flipped.
+  __m128i const bias = _mm_set1_epi32(0x80000000);
+  __m128i const limit1 = _mm_set1_epi32(0x7f ^ 0x80000000);
+  __m128i const limit2 = _mm_set1_epi32(0x7ff ^ 0x80000000);
+  __m128i const limit3 = _mm_set1_epi32(0xffff ^ 0x80000000);
+  __m128i extra = _mm_setzero_si128();
+  unsigned int i = 0;
+  for(; num - i >= 4; i += 4)
+  {
+    __m128i const v = _mm_xor_si128(_mm_loadu_si128((__m128i const*) (codepoints + i)), bias);
+    extra = _mm_sub_epi32(extra, _mm_cmpgt_epi32(v, limit1));
+    extra = _mm_sub_epi32(extra, _mm_cmpgt_epi32(v, limit2));
+    extra = _mm_sub_epi32(extra, _mm_cmpgt_epi32(v, limit3));
+  }
+
+  int lanes[4];
+  _mm_storeu_si128((__m128i*) lanes, extra);
+  *encodedLength += i + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  return i;
+}
+
+__attribute__((target("avx2")))
+static unsigned int utf8EncodedLengthAvx2(unsigned int const* codepoints, unsigned int num, int* encodedLength)
+{
+  __m256i const bias = _mm256_set1_epi32(0x80000000);
+  __m256i const limit1 = _mm256_set1_epi32(0x7f ^ 0x80000000);
+  __m256i const limit2 = _mm256_set1_epi32(0x7ff ^ 0x80000000);
+  __m256i const limit3 = _mm256_set1_epi32(0xffff ^ 0x80000000);
+  __m256i extra = _mm256_setzero_si256();
+  unsigned int i = 0;
+  for(; num - i >= 8; i += 8)
+  {
+    __m256i const v = _mm256_xor_si256(_mm256_loadu_si256((__m256i const*) (codepoints + i)), bias);
+    extra = _mm256_sub_epi32(extra, _mm256_cmpgt_epi32(v, limit1));
+    extra = _mm256_sub_epi32(extra, _mm256_cmpgt_epi32(v, limit2));
+    extra = _mm256_sub_epi32(extra, _mm256_cmpgt_epi32(v, limit3));
+  }
+
+  int lanes[8];
+  _mm256_storeu_si256((__m256i*) lanes, extra);
+  *encodedLength += i + lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+  return i + utf8EncodedLengthSse2(codepoints + i, num - i, encodedLength);
+}
+#endif
+
+static unsigned int utf8AsciiPrefix(unsigned char const* s, unsigned int length, int level)
+{
+#ifdef UTF8_SIMD_X86
+  if(level == UTF8_SIMD_AVX2)
+    return utf8AsciiPrefixAvx2(s, length);
+  if(level == UTF8_SIMD_SSE2)
+    return utf8AsciiPrefixSse2(s, length);
+#endif
+  return 0;
+}
+
+static unsigned int utf8DecodeAscii(unsigned char const* s, unsigned int length, unsigned int* result, int level)
+{
+#ifdef UTF8_SIMD_X86
+  if(level == UTF8_SIMD_AVX2)
+    return utf8DecodeAsciiAvx2(s, length, result);
+  if(level == UTF8_SIMD_SSE2)
+    return utf8DecodeAsciiSse2(s, length, result);
+#endif
+  return 0;
+}
+
+static unsigned int utf8EncodeAscii(unsigned int const* codepoints, unsigned int num, char* result, int level)
+{
+#ifdef UTF8_SIMD_X86
+  if(level == UTF8_SIMD_AVX2)
+    return utf8EncodeAsciiAvx2(codepoints, num, result);
+  if(level == UTF8_SIMD_SSE2)
+    return utf8EncodeAsciiSse2(codepoints, num, result);
+#endif
+  return 0;
+}
+
+int utf8CountCodePointsN(unsigned char const* s, unsigned int length, int* count)
+{
+  int const level = utf8SimdLevel();
+  unsigned int codepoint;
+  unsigned int state = UTF8_ACCEPT;
+  unsigned int i = 0;
+
+  *count = 0;
+  while(i < length && state != UTF8_REJECT)
+  {
+    // Whole blocks of ASCII between complete sequences are one codepoint per byte
+    if(state == UTF8_ACCEPT)
+    {
+      unsigned int const ascii = utf8AsciiPrefix(s + i, length - i, level);
+      *count += ascii;
+      i += ascii;
+    }
+
+    unsigned int const end = length - i > UTF8_SIMD_BLOCK ? i + UTF8_SIMD_BLOCK : length;
+    for(; i < end; ++i)
+      if (!utf8Decode(&state, &codepoint, s[i]))
+        *count += 1;
+  }
+
+  return state != UTF8_ACCEPT;
+}
+
+int utf8DecodeStringN(char const* chars, unsigned int length, unsigned int* result)
 {
+  unsigned char const* const s = (unsigned char const*) chars;
+  int const level = utf8SimdLevel();
   unsigned int codepoint;
-  unsigned int state = 0;
-  int i = 0;
-  char const* s;
-  for (s = chars; *s; ++s)
+  unsigned int state = UTF8_ACCEPT;
+  unsigned int i = 0;
+  int count = 0;
+
+  while(i < length && state != UTF8_REJECT)
   {
-    if (!utf8Decode(&state, &codepoint, *s))
+    if(state == UTF8_ACCEPT)
     {
-      result[i] = codepoint;
-      ++i;
+      unsigned int const ascii = utf8DecodeAscii(s + i, length - i, result + count, level);
+      count += ascii;
+      i += ascii;
+    }
+
+    unsigned int const end = length - i > UTF8_SIMD_BLOCK ? i + UTF8_SIMD_BLOCK : length;
+    for(; i < end; ++i)
+    {
+      if (!utf8Decode(&state, &codepoint, s[i]))
+      {
+        result[count] = codepoint;
+        ++count;
+      }
     }
   }
+
+  return count;
+}
+
+int utf8EncodedStringLengthN(unsigned int const* codepoints, unsigned int num)
+{
+  int encodedLength = 0;
+  unsigned int i = 0;
+
+#ifdef UTF8_SIMD_X86
+  int const level = utf8SimdLevel();
+  if(level == UTF8_SIMD_AVX2)
+    i = utf8EncodedLengthAvx2(codepoints, num, &encodedLength);
+  else if(level == UTF8_SIMD_SSE2)
+    i = utf8EncodedLengthSse2(codepoints, num, &encodedLength);
+#endif
+
+  for(; i < num; ++i)
+    encodedLength += utf8EncodedLength(codepoints[i]);
+
+  return encodedLength;
+}
+
+int utf8EncodeStringN(unsigned int const* codepoints, unsigned int num, char* result)
+{
+  int const level = utf8SimdLevel();
+  unsigned int pos = 0;
+  unsigned int i = 0;
+
+  while(i < num)
+  {
+    unsigned int const ascii = utf8EncodeAscii(codepoints + i, num - i, result + pos, level);
+    i += ascii;
+    pos += ascii;
+
+    unsigned int const end = num - i > UTF8_SIMD_BLOCK ? i + UTF8_SIMD_BLOCK : num;
+    for(; i < end; ++i)
+    {
+      int len = utf8EncodedLength(codepoints[i]);
+      utf8Encode(codepoints[i], result + pos, len);
+      pos += len;
+    }
+  }
+
+  return pos;
 }
@@ -57,6 +57,13 @@ int utf8EncodedStringLength(unsigned int const* codepoints);
 void utf8EncodeString(unsigned int const* codepoints, char* result);
 void utf8DecodeString(char const* chars, unsigned int* result);
 
+// Length-counted variants, zero bytes and codepoints are treated as ordinary characters.
+// Decode and encode return the number of codepoints and bytes written.
+int utf8CountCodePointsN(unsigned char const* s, unsigned int length, int* count);
+int utf8DecodeStringN(char const* chars, unsigned int length, unsigned int* result);
+int utf8EncodedStringLengthN(unsigned int const* codepoints, unsigned int num);
+int utf8EncodeStringN(unsigned int const* codepoints, unsigned int num, char* result);
+
 #ifdef __cplusplus
 }
 #endif
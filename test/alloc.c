@@ -0,0 +1,123 @@
+#include "consolehck.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Counts heap allocations made by consolehck while ingesting text.
+ * Linked with -Wl,--wrap for malloc, calloc and realloc so every call goes through the counters below.
+ */
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t num, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static unsigned int ALLOCATIONS = 0;
+
+void* __wrap_malloc(size_t size)
+{
+  ++ALLOCATIONS;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t num, size_t size)
+{
+  ++ALLOCATIONS;
+  return __real_calloc(num, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+  ++ALLOCATIONS;
+  return __real_realloc(ptr, size);
+}
+
+static int FAILURES = 0;
+
+static void expectAllocations(char const* name, unsigned int const before, unsigned int const expected)
+{
+  unsigned int const actual = ALLOCATIONS - before;
+  printf("%-48s %u allocation(s)\n", name, actual);
+  if(actual != expected)
+  {
+    printf("  FAIL: expected %u\n", expected);
+    ++FAILURES;
+  }
+}
+
+static void pushFormat(consolehckScrollback* scrollback, char const* format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  consolehckScrollbackPushFormatV(scrollback, format, args);
+  va_end(args);
+}
+
+int main(void)
+{
+  char const ascii[] = "The quick brown fox jumps over the lazy dog";
+  char const multibyte[] = "Pchnąć w tę łódź jeża lub ośm skrzyń fig ☺";
+  char const lines[] = "first\nsecond\nthird\n";
+  unsigned int before;
+
+  consolehckStringBuffer* buffer = consolehckStringBufferNew(256);
+
+  before = ALLOCATIONS;
+  consolehckStringBufferPushString(buffer, ascii);
+  consolehckStringBufferPushStringN(buffer, multibyte, sizeof(multibyte) - 1);
+  expectAllocations("string buffer, push within capacity", before, 0);
+
+  consolehckStringBufferClear(buffer);
+  consolehckStringBufferResize(buffer, 4);
+  before = ALLOCATIONS;
+  consolehckStringBufferPushString(buffer, multibyte);
+  expectAllocations("string buffer, push that grows", before, 1);
+
+  consolehckStringBufferFree(buffer);
+
+  consolehckScrollback* scrollback = consolehckScrollbackNew(256);
+  unsigned int i;
+
+  before = ALLOCATIONS;
+  consolehckScrollbackPushString(scrollback, ascii);
+  consolehckScrollbackPushStringN(scrollback, multibyte, sizeof(multibyte) - 1);
+  consolehckScrollbackPushString(scrollback, lines);
+  expectAllocations("scrollback, push within capacity", before, 0);
+
+  before = ALLOCATIONS;
+  consolehckScrollbackPushString(scrollback, multibyte);
+  consolehckScrollbackPushString(scrollback, multibyte);
+  consolehckScrollbackPushString(scrollback, multibyte);
+  consolehckScrollbackPushString(scrollback, multibyte);
+  expectAllocations("scrollback, pushes that grow once", before, 1);
+
+  consolehckScrollbackLimit(scrollback, 0, scrollback->bufferSize);
+  before = ALLOCATIONS;
+  for(i = 0; i < 100; ++i)
+  {
+    consolehckScrollbackPushString(scrollback, multibyte);
+  }
+  expectAllocations("scrollback, pushes into a full ring", before, 0);
+
+  consolehckScrollbackFree(scrollback);
+
+  scrollback = consolehckScrollbackNew(1024);
+
+  before = ALLOCATIONS;
+  for(i = 0; i < 8; ++i)
+  {
+    pushFormat(scrollback, "%s %u: %d %.3f %s\n", "frame", i, 60, 16.667, multibyte);
+  }
+  expectAllocations("scrollback, formatted pushes within capacity", before, 0);
+
+  before = ALLOCATIONS;
+  for(i = 0; i < 8; ++i)
+  {
+    pushFormat(scrollback, "%s %u: %d %.3f %s\n", "frame", i, 60, 16.667, multibyte);
+  }
+  expectAllocations("scrollback, formatted pushes growing text and lines", before, 2);
+
+  consolehckScrollbackFree(scrollback);
+
+  return FAILURES > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,456 @@
+#include "consolehck.h"
+#include "utf8.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Headless benchmarks of output ingestion, UTF-8 conversion, wrap layout and input scrolling, run on
+ * glhck's stub renderer so no display is needed, layout on the null font metrics. Every benchmark prints
+ * one line of JSON with the time and heap allocations per operation, the unit says what one operation is.
+ * Allocations are counted when linked with -Wl,--wrap for malloc, calloc and realloc (BENCH_COUNT_ALLOCATIONS)
+ * and are null otherwise. Arguments select the benchmarks whose names contain any of them.
+ */
+
+#define WIDTH 512
+#define HEIGHT 256
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t num, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+static unsigned long ALLOCATIONS = 0;
+
+void* __wrap_malloc(size_t size)
+{
+  ++ALLOCATIONS;
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t num, size_t size)
+{
+  ++ALLOCATIONS;
+  return __real_calloc(num, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+  ++ALLOCATIONS;
+  return __real_realloc(ptr, size);
+}
+#else
+static unsigned long ALLOCATIONS = 0;
+#endif
+
+typedef struct benchTimer {
+  char name[64];
+  struct timespec start;
+  unsigned long allocations;
+} benchTimer;
+
+static char** FILTERS = NULL;
+static int NUM_FILTERS = 0;
+static unsigned int SEED = 1;
+
+static char const* const WORDS[] = {
+  "the", "console", "renders", "output", "frame", "texture", "glyph", "wrap", "line", "buffer",
+  "scroll", "input", "history", "error:", "warning:", "0x7f3a", "12.5ms", "[info]", "queue", "drain"
+};
+static char const* const WIDE_WORDS[] = {
+  "łódź", "jeża", "skrzyń", "☺", "日本語", "テキスト", "Ωμέγα", "naïve", "façade", "→"
+};
+
+static int benchBegin(benchTimer* timer, char const* format, unsigned int const parameter)
+{
+  snprintf(timer->name, sizeof(timer->name), format, parameter);
+  if(NUM_FILTERS > 0)
+  {
+    int i;
+    int selected = 0;
+    for(i = 0; i < NUM_FILTERS && !selected; ++i)
+    {
+      selected = strstr(timer->name, FILTERS[i]) != NULL;
+    }
+    if(!selected)
+      return 0;
+  }
+
+  timer->allocations = ALLOCATIONS;
+  clock_gettime(CLOCK_MONOTONIC, &timer->start);
+  return 1;
+}
+
+static void benchEnd(benchTimer const* timer, char const* unit, unsigned long const ops)
+{
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  unsigned long const allocations = ALLOCATIONS - timer->allocations;
+  double const ns = (end.tv_sec - timer->start.tv_sec) * 1e9 + (end.tv_nsec - timer->start.tv_nsec);
+
+  printf("{\"benchmark\": \"%s\", \"unit\": \"%s\", \"ops\": %lu, \"ns_per_op\": %.3f, ", timer->name, unit, ops, ns / ops);
+#ifdef BENCH_COUNT_ALLOCATIONS
+  printf("\"allocs_per_op\": %.4f}\n", (double) allocations / ops);
+#else
+  (void) allocations;
+  printf("\"allocs_per_op\": null}\n");
+#endif
+  fflush(stdout);
+}
+
+static unsigned int benchRandom(void)
+{
+  SEED = SEED * 1103515245u + 12345u;
+  return SEED >> 16;
+}
+
+static unsigned int benchText(char* result, unsigned int const length, int const wide)
+{
+  // Words up to length bytes, every fourth one multibyte when wide, never cutting a character
+  unsigned int n = 0;
+  while(1)
+  {
+    char const* const word = wide && benchRandom() % 4 == 0 ? WIDE_WORDS[benchRandom() % 10] : WORDS[benchRandom() % 20];
+    unsigned int const wordLength = strlen(word);
+    if(n + wordLength + 1 > length)
+      break;
+
+    memcpy(result + n, word, wordLength);
+    n += wordLength;
+    result[n++] = ' ';
+  }
+
+  while(n < length)
+  {
+    result[n++] = '.';
+  }
+  result[n] = '\0';
+
+  return n;
+}
+
+static consolehckConsole* benchConsole(void)
+{
+  // Deferred so refreshes only drain the queue, benchmarks that measure rendering flush explicitly
+  consolehckConsole* const console = consolehckConsoleNew(WIDTH, HEIGHT);
+  consolehckConsoleUpdateMode(console, CONSOLEHCK_UPDATE_DEFERRED, 0.0);
+  consolehckConsoleOutputLimit(console, 10000, 0);
+  return console;
+}
+
+static void benchOutputAppend(char const* format, unsigned int const lineLength, int const wide, int const colored)
+{
+  // Lines of lineLength bytes appended to a scrollback kept full, so trimming is part of every push
+  benchTimer timer;
+  char* const line = calloc(lineLength + 32, sizeof(char));
+  unsigned int n = 0;
+  if(colored)
+  {
+    n = sprintf(line, "\x1b[3%um", benchRandom() % 8);
+  }
+  n += benchText(line + n, lineLength, wide);
+  if(colored)
+  {
+    n += sprintf(line + n, "\x1b[0m");
+  }
+  line[n++] = '\n';
+
+  consolehckConsole* const console = benchConsole();
+  unsigned int const ops = 64u * 1024 * 1024 / (lineLength + 1) < 1000000 ? 64u * 1024 * 1024 / (lineLength + 1) : 1000000;
+  unsigned int i;
+  for(i = 0; i < 10000; ++i)
+  {
+    consolehckConsoleOutputStringN(console, line, n);
+  }
+
+  if(benchBegin(&timer, format, lineLength))
+  {
+    for(i = 0; i < ops; ++i)
+    {
+      consolehckConsoleOutputStringN(console, line, n);
+    }
+    benchEnd(&timer, "line", ops);
+  }
+
+  consolehckConsoleFree(console);
+  free(line);
+}
+
+static void benchOutputFormat(void)
+{
+  benchTimer timer;
+  consolehckConsole* const console = benchConsole();
+  unsigned int const ops = 500000;
+  unsigned int i;
+  if(benchBegin(&timer, "output_format/%u_fields", 4))
+  {
+    for(i = 0; i < ops; ++i)
+    {
+      consolehckConsoleOutputFormat(console, "frame %u: %.3f ms, %d draws, %s\n", i, 16.667, 42, "ok");
+    }
+    benchEnd(&timer, "line", ops);
+  }
+
+  consolehckConsoleFree(console);
+}
+
+static void benchOutputQueued(unsigned int const lineLength)
+{
+  // Pushed through the queue and drained by a refresh every 64 lines, as a frame would
+  benchTimer timer;
+  char* const line = calloc(lineLength + 2, sizeof(char));
+  unsigned int const n = benchText(line, lineLength, 0);
+  line[n] = '\n';
+
+  consolehckConsole* const console = benchConsole();
+  unsigned int const ops = 500000;
+  unsigned int i;
+  if(benchBegin(&timer, "output_queued/%u", lineLength))
+  {
+    for(i = 0; i < ops; ++i)
+    {
+      consolehckConsoleOutputQueuedN(console, line, n + 1);
+      if(i % 64 == 63)
+      {
+        consolehckConsoleRefresh(console);
+      }
+    }
+    consolehckConsoleRefresh(console);
+    benchEnd(&timer, "line", ops);
+  }
+
+  consolehckQueueThreadRelease();
+  consolehckConsoleFree(console);
+  free(line);
+}
+
+static void benchUtf8(int const wide)
+{
+  // Whole-buffer conversions of 1 MiB of text, per byte of UTF-8
+  benchTimer timer;
+  unsigned int const size = 1024 * 1024;
+  char* const text = calloc(size + 1, sizeof(char));
+  unsigned int const length = benchText(text, size, wide);
+  unsigned int* const codepoints = calloc(length + 1, sizeof(unsigned int));
+  char* const encoded = calloc(length + 1, sizeof(char));
+  unsigned int const rounds = 64;
+  unsigned int num = 0;
+  unsigned int i;
+  char const* const format = wide ? "utf8_%s/mixed" : "utf8_%s/ascii";
+  char name[32];
+
+  snprintf(name, sizeof(name), format, "decode");
+  if(benchBegin(&timer, name, 0))
+  {
+    for(i = 0; i < rounds; ++i)
+    {
+      num = utf8DecodeStringN(text, length, codepoints);
+    }
+    benchEnd(&timer, "byte", (unsigned long) rounds * length);
+  }
+  num = utf8DecodeStringN(text, length, codepoints);
+
+  snprintf(name, sizeof(name), format, "encode");
+  if(benchBegin(&timer, name, 0))
+  {
+    for(i = 0; i < rounds; ++i)
+    {
+      utf8EncodeStringN(codepoints, num, encoded);
+    }
+    benchEnd(&timer, "byte", (unsigned long) rounds * length);
+  }
+
+  snprintf(name, sizeof(name), format, "length");
+  if(benchBegin(&timer, name, 0))
+  {
+    unsigned int total = 0;
+    for(i = 0; i < rounds; ++i)
+    {
+      total += utf8EncodedStringLengthN(codepoints, num);
+    }
+    benchEnd(&timer, "byte", (unsigned long) rounds * length);
+    if(total != rounds * length)
+    {
+      printf("utf8 round trip mismatch\n");
+    }
+  }
+
+  free(encoded);
+  free(codepoints);
+  free(text);
+}
+
+static void benchLayout(unsigned int const numLines, consolehckFontSpacing const spacing)
+{
+  /* Output layouts of a scrollback of numLines lines of up to 300 bytes, at the bottom and scrolled to its
+   * middle, with the wrap layout cached and invalidated before every layout. Glyphs are measured by the
+   * null font metrics, so only the layout engine is measured. Its glyphs are all the same width, the
+   * proportional runs lay them out as if they were not.
+   */
+  benchTimer timer;
+  consolehckConsole* const console = benchConsole();
+  consolehckFontMetrics const metrics = consolehckNullFontMetrics();
+  consolehckGlyphCache* const glyphs = consolehckGlyphCacheNew(&metrics);
+  consolehckGlyphCacheSpacing(glyphs, spacing);
+  consolehckLayout* const layout = consolehckLayoutNew();
+  consolehckScrollback* const text = consolehckScrollbackNew(1024);
+  char line[320];
+  unsigned int i;
+  for(i = 0; i < numLines; ++i)
+  {
+    unsigned int const n = benchText(line, 20 + benchRandom() % 280, i % 3 == 0);
+    line[n] = '\n';
+    consolehckScrollbackPushStringN(text, line, n + 1);
+  }
+
+  glhckRect const rect = {console->margin, console->margin, WIDTH - console->margin * 2, HEIGHT - console->margin * 2};
+  consolehckTextColors const colors = {console->textColor, console->backgroundColor, NULL, 0, console->highlightColor};
+  unsigned int const middleRow = consolehckTextRowOf(glyphs, rect.w, console->fontId, console->fontSize, text, numLines / 2, 0);
+  int const offsets[2] = {0, (int) (middleRow * console->fontSize)};
+  char const* const monospaceFormats[4] = {"layout_bottom_cached/%u", "layout_bottom_cold/%u", "layout_middle_cached/%u", "layout_middle_cold/%u"};
+  char const* const proportionalFormats[4] = {"layout_proportional_bottom_cached/%u", "layout_proportional_bottom_cold/%u",
+                                              "layout_proportional_middle_cached/%u", "layout_proportional_middle_cold/%u"};
+  char const* const* const formats = spacing == CONSOLEHCK_SPACING_PROPORTIONAL ? proportionalFormats : monospaceFormats;
+
+  unsigned int j;
+  for(j = 0; j < 4; ++j)
+  {
+    int const cold = j % 2;
+    unsigned int const ops = cold && j >= 2 ? 20 : 2000;
+    consolehckLayoutReset(layout, console->fontId, console->fontSize);
+    consolehckLayoutOutput(layout, glyphs, &rect, offsets[j / 2], CONSOLEHCK_WRAP, text, &colors);
+
+    if(benchBegin(&timer, formats[j], numLines))
+    {
+      for(i = 0; i < ops; ++i)
+      {
+        if(cold)
+        {
+          consolehckScrollbackInvalidateLayout(text);
+        }
+        consolehckLayoutReset(layout, console->fontId, console->fontSize);
+        consolehckLayoutOutput(layout, glyphs, &rect, offsets[j / 2], CONSOLEHCK_WRAP, text, &colors);
+      }
+      benchEnd(&timer, "layout", ops);
+    }
+  }
+
+  consolehckLayoutFree(layout);
+  consolehckGlyphCacheFree(glyphs);
+  consolehckScrollbackFree(text);
+  consolehckConsoleFree(console);
+}
+
+static void benchInput(unsigned int const inputLength)
+{
+  // Typing at the end of a long input line and walking the cursor back through it, flushing every change
+  benchTimer timer;
+  consolehckConsole* const console = benchConsole();
+  char* const input = calloc(inputLength + 1, sizeof(char));
+  benchText(input, inputLength, 1);
+  consolehckConsoleInputPrompt(console, "consolehck>");
+  consolehckConsoleInputString(console, input);
+  consolehckConsoleFlush(console, 0.0);
+
+  unsigned int const ops = 20000;
+  unsigned int i;
+  if(benchBegin(&timer, "input_type/%u", inputLength))
+  {
+    for(i = 0; i < ops; ++i)
+    {
+      if(i % 2 == 0)
+        consolehckConsoleInputChar(console, 'x');
+      else
+        consolehckConsoleInputPopUnicodeChar(console);
+      consolehckConsoleFlush(console, 0.0);
+    }
+    benchEnd(&timer, "keystroke", ops);
+  }
+
+  consolehckConsoleInputCursorEnd(console);
+  if(benchBegin(&timer, "input_cursor/%u", inputLength))
+  {
+    for(i = 0; i < ops; ++i)
+    {
+      if(consolehckConsoleInputGetCursor(console) == 0)
+        consolehckConsoleInputCursorEnd(console);
+      else
+        consolehckConsoleInputCursorLeft(console);
+      consolehckConsoleFlush(console, 0.0);
+    }
+    benchEnd(&timer, "keystroke", ops);
+  }
+
+  consolehckConsoleFree(console);
+  free(input);
+}
+
+static void benchDeferred(char const* format, unsigned int const linesPerFrame, int const stats)
+{
+  // Frames of a deferred console receiving linesPerFrame lines each, ticked at 60 Hz, optionally collecting stats
+  benchTimer timer;
+  consolehckConsole* const console = benchConsole();
+  consolehckConsoleStatsEnable(console, stats);
+  char line[128];
+  unsigned int const n = benchText(line, 100, 0);
+  line[n] = '\n';
+
+  unsigned int const ops = 2000;
+  unsigned int i, j;
+  if(benchBegin(&timer, format, linesPerFrame))
+  {
+    for(i = 0; i < ops; ++i)
+    {
+      for(j = 0; j < linesPerFrame; ++j)
+      {
+        consolehckConsoleOutputStringN(console, line, n + 1);
+      }
+      consolehckConsoleTick(console, i / 60.0);
+    }
+    benchEnd(&timer, "frame", ops);
+  }
+
+  consolehckConsoleFree(console);
+}
+
+int main(int argc, char** argv)
+{
+  if(!glhckContextCreate(argc, argv))
+    return EXIT_FAILURE;
+
+  if(!glhckDisplayCreate(WIDTH, HEIGHT, GLHCK_RENDER_STUB))
+    return EXIT_FAILURE;
+
+  FILTERS = argv + 1;
+  NUM_FILTERS = argc - 1;
+
+  benchOutputAppend("output_append/%u", 16, 0, 0);
+  benchOutputAppend("output_append/%u", 80, 0, 0);
+  benchOutputAppend("output_append/%u", 256, 0, 0);
+  benchOutputAppend("output_append/%u", 4096, 0, 0);
+  benchOutputAppend("output_append_utf8/%u", 80, 1, 0);
+  benchOutputAppend("output_append_sgr/%u", 80, 0, 1);
+  benchOutputFormat();
+  benchOutputQueued(80);
+
+  benchUtf8(0);
+  benchUtf8(1);
+
+  benchLayout(10000, CONSOLEHCK_SPACING_DETECT);
+  benchLayout(100000, CONSOLEHCK_SPACING_DETECT);
+  benchLayout(10000, CONSOLEHCK_SPACING_PROPORTIONAL);
+  benchLayout(100000, CONSOLEHCK_SPACING_PROPORTIONAL);
+
+  benchInput(1000);
+  benchInput(10000);
+
+  benchDeferred("deferred_frame/%u_lines", 1, 0);
+  benchDeferred("deferred_frame/%u_lines", 100, 0);
+  benchDeferred("deferred_frame_stats/%u_lines", 1, 1);
+  benchDeferred("deferred_frame_stats/%u_lines", 100, 1);
+
+  glhckContextTerminate();
+
+  return EXIT_SUCCESS;
+}
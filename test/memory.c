@@ -0,0 +1,123 @@
+#include "consolehck.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Checks that consolehckConsoleTrim gives memory back once a long input line, a long history and most of the output are gone.
+ * Runs on glhck's stub renderer, so it needs no window.
+ */
+
+#define WIDTH 800
+#define HEIGHT 480
+#define INPUT_LENGTH 100000
+#define HISTORY_ENTRIES 2000
+#define OUTPUT_LINES 5000
+#define KEPT_OUTPUT_LINES 10
+
+static int FAILURES = 0;
+
+static void expectDrop(char const* name, size_t const before, size_t const after)
+{
+  printf("%-32s %zu -> %zu bytes reserved\n", name, before, after);
+  if(after >= before)
+  {
+    printf("  FAIL: expected a drop\n");
+    ++FAILURES;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(!glhckContextCreate(argc, argv))
+    return EXIT_FAILURE;
+
+  if(!glhckDisplayCreate(WIDTH, HEIGHT, GLHCK_RENDER_STUB))
+    return EXIT_FAILURE;
+
+  consolehckConsole* const console = consolehckConsoleNew(WIDTH, HEIGHT);
+  consolehckConsoleUpdateMode(console, CONSOLEHCK_UPDATE_DEFERRED, 0.0);
+
+  char* const input = calloc(INPUT_LENGTH + 1, sizeof(char));
+  unsigned int i;
+  for(i = 0; i < INPUT_LENGTH; ++i)
+  {
+    input[i] = i % 8 == 7 ? ' ' : 'a' + i % 26;
+  }
+
+  // A long line pasted and entered, then many distinct short ones, cleared after entering like an application would
+  consolehckConsoleInputStringN(console, input, INPUT_LENGTH);
+  consolehckConsoleFlush(console, 0.0);
+  consolehckConsoleInputEnter(console);
+  consolehckConsoleInputClear(console);
+  for(i = 0; i < HISTORY_ENTRIES; ++i)
+  {
+    char line[32];
+    sprintf(line, "command %u", i);
+    consolehckConsoleInputString(console, line);
+    consolehckConsoleInputEnter(console);
+    consolehckConsoleInputClear(console);
+  }
+  consolehckConsoleFlush(console, 0.0);
+
+  // Colored output, so it has spans as well as text and lines
+  for(i = 0; i < OUTPUT_LINES; ++i)
+  {
+    consolehckConsoleOutputFormat(console, "\x1b[3%um%u %s\x1b[0m\n", i % 8, i, "output line");
+  }
+  consolehckConsoleFlush(console, 0.0);
+
+  // Searching the output builds its index
+  consolehckConsoleOutputFind(console, "output line");
+  consolehckConsoleOutputFindEnd(console);
+
+  // History is cleared down to its newest entry and the output to its newest lines
+  consolehckConsoleInputHistoryLimit(console, 1);
+  consolehckConsoleOutputLimit(console, KEPT_OUTPUT_LINES, 0);
+
+  consolehckMemoryUsage before, after;
+  consolehckConsoleMemoryUsage(console, &before);
+  consolehckConsoleTrim(console);
+  consolehckConsoleMemoryUsage(console, &after);
+
+  expectDrop("input", before.input.reserved, after.input.reserved);
+  expectDrop("history", before.history.reserved, after.history.reserved);
+  expectDrop("output", before.output.reserved, after.output.reserved);
+  expectDrop("indexes", before.indexes.reserved, after.indexes.reserved);
+  expectDrop("total", before.total.reserved, after.total.reserved);
+
+  // Trimmed buffers still work and grow again
+  consolehckConsoleInputStringN(console, input, 1000);
+  consolehckConsoleInputEnter(console);
+  consolehckConsoleFlush(console, 0.0);
+  consolehckConsoleInputClear(console);
+  if(consolehckHistoryCount(console->input.history) != 1)
+  {
+    printf("FAIL: history lost its limit after trimming\n");
+    ++FAILURES;
+  }
+
+  consolehckConsoleOutputString(console, "after trimming\n");
+  consolehckConsoleFlush(console, 0.0);
+  consolehckScrollback* const output = console->output.text;
+  consolehckLine const* const last = consolehckScrollbackGetLine(output, consolehckScrollbackLineCount(output) - 2);
+  char text[32] = {0};
+  consolehckScrollbackCopyLine(output, consolehckScrollbackLineCount(output) - 2, text);
+  consolehckMatch match;
+  if(!consolehckScrollbackFindPrevious(output, "after", 5, consolehckScrollbackLineCount(output), 0, &match))
+  {
+    printf("FAIL: output search lost lines after trimming\n");
+    ++FAILURES;
+  }
+  if(consolehckScrollbackLineCount(output) != KEPT_OUTPUT_LINES + 1 || last->length != strlen("after trimming") || strcmp(text, "after trimming") != 0)
+  {
+    printf("FAIL: output lost lines after trimming\n");
+    ++FAILURES;
+  }
+
+  consolehckConsoleFree(console);
+  free(input);
+  glhckContextTerminate();
+
+  return FAILURES > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
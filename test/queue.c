@@ -0,0 +1,136 @@
+#include "consolehck.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Many threads log through one output queue while the main thread keeps draining it into a scrollback.
+ * Every line carries its worker and sequence number and a payload derived from both, so lost,
+ * reordered or torn lines all show up when the scrollback is checked afterwards.
+ */
+
+#define NUM_WORKERS 16
+#define LINES_PER_WORKER 20000
+#define MAX_PAYLOAD 300
+
+static consolehckQueue* QUEUE = NULL;
+static atomic_int RUNNING_WORKERS = NUM_WORKERS;
+
+static unsigned int payloadLength(unsigned int const worker, unsigned int const line)
+{
+  // Mostly short lines with the odd one much longer than the rest
+  return line % 50 == 0 ? MAX_PAYLOAD : (worker * 7 + line) % 40;
+}
+
+static void* worker(void* arg)
+{
+  unsigned int const id = (unsigned int) (size_t) arg;
+  char line[64 + MAX_PAYLOAD];
+  unsigned int i;
+
+  for(i = 0; i < LINES_PER_WORKER; ++i)
+  {
+    int length = snprintf(line, 64, "worker %u line %u ", id, i);
+    unsigned int const payload = payloadLength(id, i);
+    memset(line + length, 'a' + id % 26, payload);
+    length += payload;
+    line[length++] = '\n';
+    consolehckQueuePush(QUEUE, line, length);
+  }
+
+  consolehckQueueThreadRelease();
+  atomic_fetch_sub(&RUNNING_WORKERS, 1);
+  return NULL;
+}
+
+int main(void)
+{
+  pthread_t threads[NUM_WORKERS];
+  unsigned int nextLine[NUM_WORKERS] = {0};
+  unsigned int i;
+
+  QUEUE = consolehckQueueNew();
+  consolehckScrollback* scrollback = consolehckScrollbackNew(1024);
+
+  for(i = 0; i < NUM_WORKERS; ++i)
+  {
+    pthread_create(&threads[i], NULL, worker, (void*) (size_t) i);
+  }
+
+  while(atomic_load(&RUNNING_WORKERS) > 0)
+  {
+    consolehckQueueDrain(QUEUE, scrollback);
+  }
+
+  for(i = 0; i < NUM_WORKERS; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+  consolehckQueueDrain(QUEUE, scrollback);
+
+  // Every complete line must be intact and come right after the previous line of the same worker
+  unsigned int const numLines = consolehckScrollbackLineCount(scrollback) - 1;
+  unsigned int failures = 0;
+  char* const text = calloc(64 + MAX_PAYLOAD + 1, sizeof(char));
+  for(i = 0; i < numLines && failures < 10; ++i)
+  {
+    consolehckLine const* const line = consolehckScrollbackGetLine(scrollback, i);
+    if(line->length > 64 + MAX_PAYLOAD)
+    {
+      printf("FAIL: line %u is %u bytes long\n", i, line->length);
+      ++failures;
+      continue;
+    }
+
+    consolehckScrollbackCopyLine(scrollback, i, text);
+    text[line->length] = '\0';
+
+    unsigned int id, number;
+    int prefix;
+    if(sscanf(text, "worker %u line %u %n", &id, &number, &prefix) != 2 || id >= NUM_WORKERS)
+    {
+      printf("FAIL: line %u is torn: '%s'\n", i, text);
+      ++failures;
+      continue;
+    }
+
+    unsigned int const payload = payloadLength(id, number);
+    unsigned int j;
+    int intact = line->length == prefix + payload;
+    for(j = 0; intact && j < payload; ++j)
+    {
+      intact = text[prefix + j] == 'a' + (char) (id % 26);
+    }
+
+    if(!intact)
+    {
+      printf("FAIL: line %u is torn: '%s'\n", i, text);
+      ++failures;
+    }
+    else if(number != nextLine[id])
+    {
+      printf("FAIL: worker %u line %u arrived when line %u was expected\n", id, number, nextLine[id]);
+      ++failures;
+    }
+    nextLine[id] = number + 1;
+  }
+
+  for(i = 0; i < NUM_WORKERS; ++i)
+  {
+    if(nextLine[i] != LINES_PER_WORKER)
+    {
+      printf("FAIL: worker %u stopped at line %u of %u\n", i, nextLine[i], LINES_PER_WORKER);
+      ++failures;
+    }
+  }
+
+  printf("%u lines from %u workers, %u failures\n", numLines, NUM_WORKERS, failures);
+
+  free(text);
+  consolehckScrollbackFree(scrollback);
+  consolehckQueueFree(QUEUE);
+
+  return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
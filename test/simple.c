@@ -21,7 +21,7 @@ static void windowCharCallback(GLFWwindow* w, unsigned int c)
 {
   consolehckConsole* console = glfwGetWindowUserPointer(w);
   consolehckConsoleInputUnicodeChar(console, c);
-  consolehckConsoleUpdate(console);
+  consolehckConsoleRefresh(console);
 }
 
 static void windowKeyCallback(GLFWwindow* w, int key, int scancode, int action, int mods)
@@ -30,22 +30,81 @@ static void windowKeyCallback(GLFWwindow* w, int key, int scancode, int action,
   if(key == GLFW_KEY_ENTER && action == GLFW_PRESS)
   {
     consolehckConsoleInputEnter(console);
-    consolehckConsoleUpdate(console);
+    consolehckConsoleRefresh(console);
   }
   else if(key == GLFW_KEY_BACKSPACE && (action == GLFW_PRESS || action == GLFW_REPEAT))
   {
     consolehckConsoleInputPopUnicodeChar(console);
-    consolehckConsoleUpdate(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_DELETE && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    consolehckConsoleInputDelete(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_LEFT && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    if(mods & GLFW_MOD_CONTROL)
+      consolehckConsoleInputCursorWordLeft(console);
+    else
+      consolehckConsoleInputCursorLeft(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_RIGHT && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    if(mods & GLFW_MOD_CONTROL)
+      consolehckConsoleInputCursorWordRight(console);
+    else
+      consolehckConsoleInputCursorRight(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_HOME && action == GLFW_PRESS)
+  {
+    consolehckConsoleInputCursorHome(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_END && action == GLFW_PRESS)
+  {
+    consolehckConsoleInputCursorEnd(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_TAB && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    consolehckConsoleInputComplete(console);
+    consolehckConsoleRefresh(console);
   }
   else if(key == GLFW_KEY_UP && (action == GLFW_PRESS || action == GLFW_REPEAT))
   {
-    consolehckConsoleOutputOffset(console, consolehckConsoleOutputGetOffset(console) + 12);
-    consolehckConsoleUpdate(console);
+    consolehckConsoleInputHistoryPrevious(console);
+    consolehckConsoleRefresh(console);
   }
   else if(key == GLFW_KEY_DOWN && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    consolehckConsoleInputHistoryNext(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_R && (mods & GLFW_MOD_CONTROL) && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    consolehckConsoleInputSearch(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_F3 && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    if(mods & GLFW_MOD_SHIFT)
+      consolehckConsoleOutputFindNext(console);
+    else
+      consolehckConsoleOutputFindPrevious(console);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_PAGE_UP && (action == GLFW_PRESS || action == GLFW_REPEAT))
+  {
+    consolehckConsoleOutputOffset(console, consolehckConsoleOutputGetOffset(console) + 12);
+    consolehckConsoleRefresh(console);
+  }
+  else if(key == GLFW_KEY_PAGE_DOWN && (action == GLFW_PRESS || action == GLFW_REPEAT))
   {
     consolehckConsoleOutputOffset(console, consolehckConsoleOutputGetOffset(console) - 12);
-    consolehckConsoleUpdate(console);
+    consolehckConsoleRefresh(console);
   }
 }
 
@@ -54,11 +113,55 @@ static consolehckContinue inputEnterCallback(consolehckConsole* console, unsigne
   consolehckConsoleOutputUnicodeString(console, c);
   consolehckConsoleOutputChar(console, '\n');
   consolehckConsoleInputClear(console);
-  consolehckConsoleUpdate(console);
+  consolehckConsoleRefresh(console);
 
   return CONSOLEHCK_CONTINUE;
 }
 
+static consolehckContinue echoCommand(consolehckConsole* console, unsigned int const* c, unsigned int const argc, consolehckToken const* argv)
+{
+  unsigned int i;
+  for(i = 1; i < argc; ++i)
+  {
+    consolehckConsoleOutputUnicodeStringN(console, c + argv[i].start, argv[i].length);
+    consolehckConsoleOutputChar(console, i + 1 < argc ? ' ' : '\n');
+  }
+  consolehckConsoleInputClear(console);
+  consolehckConsoleRefresh(console);
+
+  return CONSOLEHCK_STOP;
+}
+
+static consolehckContinue findCommand(consolehckConsole* console, unsigned int const* c, unsigned int const argc, consolehckToken const* argv)
+{
+  // ASCII queries are enough for testing
+  if(argc < 2)
+  {
+    consolehckConsoleOutputFindEnd(console);
+  }
+  else
+  {
+    char query[256];
+    unsigned int i;
+    for(i = 0; i < argv[1].length && i < sizeof(query); ++i)
+    {
+      query[i] = c[argv[1].start + i] < 128 ? c[argv[1].start + i] : '?';
+    }
+    consolehckConsoleOutputFindN(console, query, i);
+  }
+  consolehckConsoleInputClear(console);
+  consolehckConsoleRefresh(console);
+
+  return CONSOLEHCK_STOP;
+}
+
+static void echoCompleter(consolehckConsole* console, unsigned int const* c, unsigned int const argc, consolehckToken const* argv, consolehckCompletions* completions)
+{
+  consolehckCompletionsAddString(completions, "hello");
+  consolehckCompletionsAddString(completions, "help");
+  consolehckCompletionsAddString(completions, "world");
+}
+
 static char const* const LOREM_IPSUM = "Lorem ipsum dolor sit amet, consectetur adipisicing elit, sed do eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla pariatur. Excepteur sint occaecat cupidatat non proident, sunt in culpa qui officia deserunt mollit anim id est laborum.";
 static GLFWwindow* window;
 static consolehckConsole* console;
@@ -96,6 +199,7 @@ int main(int argc, char** argv)
 static void mainloop(void)
 {
   glfwPollEvents();
+  consolehckConsoleTick(console, glfwGetTime());
   glhckObjectRender(console->object);
   glfwSwapBuffers(window);
   glhckRenderClear(GLHCK_DEPTH_BUFFER_BIT | GLHCK_COLOR_BUFFER_BIT);
@@ -114,6 +218,11 @@ void run(GLFWwindow* window)
   glfwSetCharCallback(window, windowCharCallback);
   glfwSetKeyCallback(window, windowKeyCallback);
   consolehckConsoleInputCallbackRegister(console, inputEnterCallback);
+  consolehckConsoleCommandRegister(console, "echo", echoCommand);
+  consolehckConsoleCommandCompleter(console, "echo", echoCompleter);
+  consolehckConsoleCommandRegister(console, "find", findCommand);
+  consolehckConsoleOutputLimit(console, 1000, 0);
+  consolehckConsoleUpdateMode(console, CONSOLEHCK_UPDATE_DEFERRED, 0.0);
 
   glhckObjectPositionf(console->object, WIDTH/2.0f, HEIGHT/2.0f, 0);
 
@@ -121,6 +230,11 @@ void run(GLFWwindow* window)
   consolehckConsoleInputString(console, "Hello Input!");
   consolehckConsoleOutputString(console, "1 Hello Output!\n");
   consolehckConsoleOutputString(console, "2 Hello Output!\n3 Hello Output!\n");
+  consolehckConsoleOutputString(console, "\x1b[32mok\x1b[0m \x1b[1;33mwarning\x1b[0m \x1b[31merror\x1b[0m \x1b[7minverse\x1b[27m\n");
+  consolehckConsoleOutputString(console, "\x1b]0;title\x07\x1b(Bother \x1bPq#0;2;0;0;0\x1b\\escapes \x1b_apc\x1b\\are hidden\n");
+  consolehckConsoleOutputColorb(console, 128, 160, 255, 255);
+  consolehckConsoleOutputString(console, "Colored Output!\n");
+  consolehckConsoleOutputStyleReset(console);
   consolehckConsoleOutputString(console, LOREM_IPSUM);
   consolehckConsoleOutputChar(console, '\n');
   consolehckConsoleUpdate(console);
@@ -133,6 +247,7 @@ void run(GLFWwindow* window)
   while(RUNNING && glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS)
   {
     glfwPollEvents();
+    consolehckConsoleTick(console, glfwGetTime());
     glhckObjectRender(console->object);
     glfwSwapBuffers(window);
     glhckRenderClear(GLHCK_DEPTH_BUFFER_BIT | GLHCK_COLOR_BUFFER_BIT);